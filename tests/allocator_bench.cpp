@@ -0,0 +1,530 @@
+// SDK includes
+#include <bento_base/log.h>
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+#include <bento_memory/system_allocator.h>
+#include <bento_memory/safe_system_allocator.h>
+#include <bento_memory/page_allocator.h>
+#include <bento_memory/book_allocator.h>
+#include <bento_memory/concurrent_book_allocator.h>
+#include <bento_memory/thread_cache_allocator.h>
+#include <bento_collection/vector.h>
+
+// External includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Internal includes
+#include "bench_utils.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Only one operation out of SampleRate is timed, timing all of them would measure the clock
+const uint32_t SampleRate = 32;
+
+// Number of objects every thread keeps alive in the churn workloads
+const uint32_t LiveSetSize = 64;
+
+// Capacity of the queue between a producer and its consumer
+const uint32_t QueueCapacity = 1024;
+
+// Number of times the larson workload hands the live sets over to another thread
+const uint32_t LarsonRounds = 8;
+
+namespace AllocatorType
+{
+	enum Type
+	{
+		SYSTEM = 0,
+		SAFE_SYSTEM,
+		PAGE,
+		BOOK,
+		THREAD_CACHE,
+		CONCURRENT_BOOK,
+		COUNT
+	};
+}
+
+struct AllocatorDescriptor
+{
+	const char* name;
+	// Can be used from several threads and freed from another thread than the one that allocated
+	bool threadSafe;
+	// Biggest allocation the allocator can serve
+	uint32_t maxSize;
+};
+
+const AllocatorDescriptor AllocatorDescriptors[AllocatorType::COUNT] =
+{
+	{ "system", true, 0xffffffff },
+	{ "safe_system", true, 0xffffffff },
+	{ "page", false, 256 },
+	{ "book", false, 256 },
+	{ "thread_cache", true, 256 },
+	{ "concurrent_book", true, 256 },
+};
+
+// Owns the allocator under test for the duration of a single run
+class AllocatorUnderTest
+{
+public:
+	AllocatorUnderTest(AllocatorType::Type type, uint32_t numThreads, bento::IAllocator& backingAllocator)
+	: _type(type)
+	{
+		switch (_type)
+		{
+			case AllocatorType::PAGE:
+				_pageAllocator.initialize(256, 4096);
+			break;
+			case AllocatorType::BOOK:
+				bento::book_allocator::initialize(_bookAllocator, 16, 256, backingAllocator, 1);
+			break;
+			case AllocatorType::THREAD_CACHE:
+				bento::book_allocator::initialize(_bookAllocator, 16, 256, backingAllocator, 1);
+				_threadCacheAllocator.initialize(_bookAllocator, 32);
+			break;
+			case AllocatorType::CONCURRENT_BOOK:
+				// One arena per worker thread of the run
+				bento::concurrent_book_allocator::initialize(_concurrentBookAllocator, 16, 256, numThreads, backingAllocator);
+			break;
+			default:
+			break;
+		}
+	}
+
+	~AllocatorUnderTest()
+	{
+		// Give the pages of the growable books back so that they don't skew the following runs
+		if (_type == AllocatorType::BOOK || _type == AllocatorType::THREAD_CACHE)
+		{
+			_bookAllocator.release();
+		}
+		else if (_type == AllocatorType::CONCURRENT_BOOK)
+		{
+			// Frees that reached an arena after its owner thread exited are still queued
+			_concurrentBookAllocator.drain_all_remote_frees();
+			_concurrentBookAllocator.release();
+		}
+	}
+
+	bento::IAllocator& allocator()
+	{
+		switch (_type)
+		{
+			case AllocatorType::SYSTEM:
+				return _systemAllocator;
+			case AllocatorType::SAFE_SYSTEM:
+				return _safeSystemAllocator;
+			case AllocatorType::PAGE:
+				return _pageAllocator;
+			case AllocatorType::BOOK:
+				return _bookAllocator;
+			case AllocatorType::THREAD_CACHE:
+				return _threadCacheAllocator;
+			default:
+				return _concurrentBookAllocator;
+		}
+	}
+
+	// Must be called by every worker thread before it exits
+	void thread_exit()
+	{
+		if (_type == AllocatorType::THREAD_CACHE)
+			_threadCacheAllocator.flush();
+		else if (_type == AllocatorType::CONCURRENT_BOOK)
+			_concurrentBookAllocator.drain_remote_frees();
+	}
+
+private:
+	AllocatorType::Type _type;
+	bento::SystemAllocator _systemAllocator;
+	bento::SafeSystemAllocator _safeSystemAllocator;
+	bento::PageAllocator _pageAllocator;
+	bento::BookAllocator _bookAllocator;
+	bento::ThreadCacheAllocator _threadCacheAllocator;
+	bento::ConcurrentBookAllocator _concurrentBookAllocator;
+};
+
+// Spin barrier used to synchronize the rounds of the larson workload
+class SpinBarrier
+{
+public:
+	SpinBarrier(uint32_t numThreads)
+	: _numThreads(numThreads)
+	, _waiting(0)
+	, _generation(0)
+	{
+	}
+
+	void wait()
+	{
+		uint32_t generation = _generation.load();
+		if (_waiting.fetch_add(1) + 1 == _numThreads)
+		{
+			_waiting.store(0);
+			_generation.fetch_add(1);
+		}
+		else
+		{
+			while (_generation.load() == generation)
+				std::this_thread::yield();
+		}
+	}
+
+private:
+	uint32_t _numThreads;
+	std::atomic<uint32_t> _waiting;
+	std::atomic<uint32_t> _generation;
+};
+
+// Single producer, single consumer queue used for the cross thread frees
+struct PointerQueue
+{
+	void* slots[QueueCapacity];
+	std::atomic<uint32_t> head;
+	std::atomic<uint32_t> tail;
+};
+
+// Everything a worker thread needs for a given run
+struct WorkloadContext
+{
+	AllocatorUnderTest* allocatorUnderTest;
+	bento::IAllocator* allocator;
+	uint32_t numThreads;
+	uint32_t opsPerThread;
+	bento::Vector<PointerQueue*>* queues;
+	bento::Vector<void*>* larsonSlots;
+	SpinBarrier* barrier;
+	std::atomic<uint64_t>* failedAllocations;
+};
+
+// Per thread measurements
+struct ThreadResult
+{
+	ThreadResult(bento::IAllocator& allocator)
+	: latencies(allocator)
+	, operations(0)
+	{
+	}
+
+	bento::Vector<uint64_t> latencies;
+	uint64_t operations;
+};
+
+// Allocates and records the latency of one operation out of SampleRate
+inline void* timed_allocate(WorkloadContext& context, ThreadResult& result, size_t size)
+{
+	void* ptr = nullptr;
+	if ((result.operations++ % SampleRate) == 0)
+	{
+		Clock::time_point start = Clock::now();
+		ptr = context.allocator->allocate(size, 8);
+		Clock::time_point end = Clock::now();
+		result.latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+	}
+	else
+	{
+		ptr = context.allocator->allocate(size, 8);
+	}
+
+	if (ptr == nullptr)
+		context.failedAllocations->fetch_add(1);
+	return ptr;
+}
+
+// Frees and records the latency of one operation out of SampleRate
+inline void timed_free(WorkloadContext& context, ThreadResult& result, void* ptr)
+{
+	if (ptr == nullptr)
+		return;
+
+	if ((result.operations++ % SampleRate) == 0)
+	{
+		Clock::time_point start = Clock::now();
+		context.allocator->deallocate(ptr);
+		Clock::time_point end = Clock::now();
+		result.latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+	}
+	else
+	{
+		context.allocator->deallocate(ptr);
+	}
+}
+
+uint32_t mixed_size(RandomGenerator& generator)
+{
+	return 8 + generator.next() % 249;
+}
+
+// Every thread replaces the oldest object of its live set with a new one of the same size
+void fixed_churn_workload(WorkloadContext& context, uint32_t, ThreadResult& result)
+{
+	void* liveSet[LiveSetSize] = {};
+	for (uint32_t opIdx = 0; opIdx < context.opsPerThread / 2; ++opIdx)
+	{
+		uint32_t slotIdx = opIdx % LiveSetSize;
+		timed_free(context, result, liveSet[slotIdx]);
+		liveSet[slotIdx] = timed_allocate(context, result, 64);
+	}
+	for (uint32_t slotIdx = 0; slotIdx < LiveSetSize; ++slotIdx)
+	{
+		if (liveSet[slotIdx] != nullptr)
+			context.allocator->deallocate(liveSet[slotIdx]);
+	}
+}
+
+// Every thread replaces random objects of its live set with objects of random sizes
+void mixed_size_workload(WorkloadContext& context, uint32_t threadIdx, ThreadResult& result)
+{
+	RandomGenerator generator = { 0x853c49e6748fea9bull + threadIdx };
+	void* liveSet[LiveSetSize] = {};
+	for (uint32_t opIdx = 0; opIdx < context.opsPerThread / 2; ++opIdx)
+	{
+		uint32_t slotIdx = generator.next() % LiveSetSize;
+		timed_free(context, result, liveSet[slotIdx]);
+		liveSet[slotIdx] = timed_allocate(context, result, mixed_size(generator));
+	}
+	for (uint32_t slotIdx = 0; slotIdx < LiveSetSize; ++slotIdx)
+	{
+		if (liveSet[slotIdx] != nullptr)
+			context.allocator->deallocate(liveSet[slotIdx]);
+	}
+}
+
+// Even threads allocate and hand the objects to the next thread which frees them
+void producer_consumer_workload(WorkloadContext& context, uint32_t threadIdx, ThreadResult& result)
+{
+	PointerQueue& queue = *(*context.queues)[threadIdx / 2];
+	uint32_t numObjects = context.opsPerThread;
+	RandomGenerator generator = { 0x853c49e6748fea9bull + threadIdx };
+	if ((threadIdx % 2) == 0)
+	{
+		for (uint32_t objectIdx = 0; objectIdx < numObjects; ++objectIdx)
+		{
+			void* ptr = timed_allocate(context, result, mixed_size(generator));
+			uint32_t head = queue.head.load(std::memory_order_relaxed);
+			while (head - queue.tail.load(std::memory_order_acquire) == QueueCapacity)
+				std::this_thread::yield();
+			queue.slots[head % QueueCapacity] = ptr;
+			queue.head.store(head + 1, std::memory_order_release);
+		}
+	}
+	else
+	{
+		for (uint32_t objectIdx = 0; objectIdx < numObjects; ++objectIdx)
+		{
+			uint32_t tail = queue.tail.load(std::memory_order_relaxed);
+			while (queue.head.load(std::memory_order_acquire) == tail)
+				std::this_thread::yield();
+			void* ptr = queue.slots[tail % QueueCapacity];
+			queue.tail.store(tail + 1, std::memory_order_release);
+			timed_free(context, result, ptr);
+		}
+	}
+}
+
+// Larson: random replacements in a live set that is handed over to another thread at every round
+void larson_workload(WorkloadContext& context, uint32_t threadIdx, ThreadResult& result)
+{
+	RandomGenerator generator = { 0x853c49e6748fea9bull + threadIdx };
+	uint32_t opsPerRound = context.opsPerThread / (2 * LarsonRounds);
+	for (uint32_t roundIdx = 0; roundIdx < LarsonRounds; ++roundIdx)
+	{
+		// The live set allocated by another thread during the previous round
+		uint32_t setOffset = ((threadIdx + roundIdx) % context.numThreads) * LiveSetSize;
+		for (uint32_t opIdx = 0; opIdx < opsPerRound; ++opIdx)
+		{
+			uint32_t slotIdx = setOffset + generator.next() % LiveSetSize;
+			timed_free(context, result, (*context.larsonSlots)[slotIdx]);
+			(*context.larsonSlots)[slotIdx] = timed_allocate(context, result, mixed_size(generator));
+		}
+		context.barrier->wait();
+	}
+}
+
+// Every thread grows vectors element by element and throws them away
+void vector_growth_workload(WorkloadContext& context, uint32_t, ThreadResult& result)
+{
+	const uint32_t vectorSize = 4096;
+	bento::Vector<uint64_t> values(*context.allocator);
+	for (uint32_t opIdx = 0; opIdx < context.opsPerThread; ++opIdx)
+	{
+		if ((opIdx % vectorSize) == 0)
+			values.free();
+
+		if ((result.operations++ % SampleRate) == 0)
+		{
+			Clock::time_point start = Clock::now();
+			values.push_back(opIdx);
+			Clock::time_point end = Clock::now();
+			result.latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+		}
+		else
+		{
+			values.push_back(opIdx);
+		}
+	}
+	values.free();
+}
+
+typedef void (*WorkloadFunction)(WorkloadContext& context, uint32_t threadIdx, ThreadResult& result);
+
+struct WorkloadDescriptor
+{
+	const char* name;
+	WorkloadFunction function;
+	// Objects are freed by another thread than the one that allocated them
+	bool crossThread;
+	// Needs the threads to work in pairs
+	bool pairedThreads;
+	// Biggest allocation the workload does
+	uint32_t maxSize;
+};
+
+const WorkloadDescriptor WorkloadDescriptors[] =
+{
+	{ "fixed_churn", fixed_churn_workload, false, false, 64 },
+	{ "mixed_size", mixed_size_workload, false, false, 256 },
+	{ "producer_consumer", producer_consumer_workload, true, true, 256 },
+	{ "larson", larson_workload, true, false, 256 },
+	{ "vector_growth", vector_growth_workload, false, false, 4096 * sizeof(uint64_t) },
+};
+
+void run_workload(const WorkloadDescriptor& workload, AllocatorType::Type allocatorType, uint32_t numThreads, uint32_t opsPerThread, bento::IAllocator& benchAllocator)
+{
+	AllocatorUnderTest allocatorUnderTest(allocatorType, numThreads, benchAllocator);
+	std::atomic<uint64_t> failedAllocations(0);
+	SpinBarrier barrier(numThreads);
+
+	// Shared structures of the cross thread workloads
+	bento::Vector<PointerQueue*> queues(benchAllocator);
+	for (uint32_t pairIdx = 0; pairIdx < numThreads / 2; ++pairIdx)
+	{
+		PointerQueue* queue = bento::make_new<PointerQueue>(benchAllocator);
+		queue->head.store(0);
+		queue->tail.store(0);
+		queues.push_back(queue);
+	}
+	bento::Vector<void*> larsonSlots(benchAllocator, numThreads * LiveSetSize);
+	for (uint32_t slotIdx = 0; slotIdx < numThreads * LiveSetSize; ++slotIdx)
+		larsonSlots[slotIdx] = nullptr;
+
+	WorkloadContext context;
+	context.allocatorUnderTest = &allocatorUnderTest;
+	context.allocator = &allocatorUnderTest.allocator();
+	context.numThreads = numThreads;
+	context.opsPerThread = opsPerThread;
+	context.queues = &queues;
+	context.larsonSlots = &larsonSlots;
+	context.barrier = &barrier;
+	context.failedAllocations = &failedAllocations;
+
+	// Prepare the per thread results before starting the clock
+	bento::Vector<ThreadResult*> results(benchAllocator);
+	for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+	{
+		ThreadResult* result = bento::make_new<ThreadResult>(benchAllocator, benchAllocator);
+		result->latencies.reserve(opsPerThread * 2 / SampleRate + 1);
+		results.push_back(result);
+	}
+
+	reset_peak_resident_memory();
+	Clock::time_point start = Clock::now();
+	bento::Vector<std::thread*> threads(benchAllocator);
+	for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+	{
+		ThreadResult* result = results[threadIdx];
+		threads.push_back(bento::make_new<std::thread>(benchAllocator, [&workload, &context, threadIdx, result]()
+		{
+			workload.function(context, threadIdx, *result);
+			context.allocatorUnderTest->thread_exit();
+		}));
+	}
+	for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+	{
+		threads[threadIdx]->join();
+		bento::make_delete<std::thread>(benchAllocator, threads[threadIdx]);
+	}
+	Clock::time_point end = Clock::now();
+	uint64_t peakMemory = peak_resident_memory();
+
+	// Release what the larson workload kept alive
+	for (uint32_t slotIdx = 0; slotIdx < numThreads * LiveSetSize; ++slotIdx)
+	{
+		if (larsonSlots[slotIdx] != nullptr)
+			context.allocator->deallocate(larsonSlots[slotIdx]);
+	}
+	allocatorUnderTest.thread_exit();
+
+	// Merge the measurements of all the threads
+	uint64_t totalOperations = 0;
+	bento::Vector<uint64_t> latencies(benchAllocator);
+	for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+	{
+		ThreadResult* result = results[threadIdx];
+		totalOperations += result->operations;
+		for (uint32_t sampleIdx = 0; sampleIdx < result->latencies.size(); ++sampleIdx)
+			latencies.push_back(result->latencies[sampleIdx]);
+		bento::make_delete<ThreadResult>(benchAllocator, result);
+	}
+	for (uint32_t pairIdx = 0; pairIdx < queues.size(); ++pairIdx)
+		bento::make_delete<PointerQueue>(benchAllocator, queues[pairIdx]);
+
+	std::sort(latencies.begin(), latencies.end());
+	uint32_t numSamples = latencies.size();
+	double seconds = std::chrono::duration<double>(end - start).count();
+
+	// One machine readable line per run
+	printf("workload=%s allocator=%s threads=%u ops=%llu seconds=%f ops_per_second=%f p50_ns=%llu p99_ns=%llu peak_rss_bytes=%llu failed_allocations=%llu\n"
+		, workload.name, AllocatorDescriptors[allocatorType].name, numThreads
+		, (unsigned long long)totalOperations, seconds, seconds > 0.0 ? totalOperations / seconds : 0.0
+		, (unsigned long long)(numSamples > 0 ? latencies[numSamples / 2] : 0)
+		, (unsigned long long)(numSamples > 0 ? latencies[(uint32_t)(numSamples * 0.99)] : 0)
+		, (unsigned long long)peakMemory, (unsigned long long)failedAllocations.load());
+	fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+	// Optional parameters: maximal number of threads and number of operations per thread
+	uint32_t maxThreads = argc > 1 ? (uint32_t)atoi(argv[1]) : std::thread::hardware_concurrency();
+	uint32_t opsPerThread = argc > 2 ? (uint32_t)atoi(argv[2]) : 1000000;
+	maxThreads = maxThreads == 0 ? 1 : maxThreads;
+
+	bento::default_logger()->log(bento::LogLevel::info, "BENCH", "Running allocator benchmarks.");
+
+	// Queues, results and latency samples never go through the allocators under test
+	bento::SystemAllocator benchAllocator;
+
+	const uint32_t numWorkloads = sizeof(WorkloadDescriptors) / sizeof(WorkloadDescriptor);
+	for (uint32_t workloadIdx = 0; workloadIdx < numWorkloads; ++workloadIdx)
+	{
+		const WorkloadDescriptor& workload = WorkloadDescriptors[workloadIdx];
+		for (uint32_t allocatorIdx = 0; allocatorIdx < AllocatorType::COUNT; ++allocatorIdx)
+		{
+			const AllocatorDescriptor& allocator = AllocatorDescriptors[allocatorIdx];
+
+			// Skip the combinations the allocator can't serve
+			if (workload.maxSize > allocator.maxSize || (workload.crossThread && !allocator.threadSafe))
+				continue;
+
+			// Powers of two up to the maximal thread count, which is always measured
+			for (uint32_t numThreads = 1; numThreads <= maxThreads; numThreads = (numThreads * 2 > maxThreads && numThreads != maxThreads) ? maxThreads : numThreads * 2)
+			{
+				if (!allocator.threadSafe && numThreads > 1)
+					break;
+				if (!workload.pairedThreads || (numThreads % 2) == 0)
+					run_workload(workload, (AllocatorType::Type)allocatorIdx, numThreads, opsPerThread, benchAllocator);
+			}
+		}
+	}
+
+	bento::default_logger()->log(bento::LogLevel::info, "BENCH", "Allocator benchmarks done.");
+
+	return 0;
+}
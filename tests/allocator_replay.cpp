@@ -0,0 +1,193 @@
+// SDK includes
+#include <bento_base/log.h>
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+#include <bento_memory/system_allocator.h>
+#include <bento_memory/safe_system_allocator.h>
+#include <bento_memory/page_allocator.h>
+#include <bento_memory/book_allocator.h>
+#include <bento_memory/tlsf_allocator.h>
+#include <bento_memory/trace_allocator.h>
+#include <bento_collection/vector.h>
+
+// External includes
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+// Internal includes
+#include "bench_utils.h"
+
+// Result of the replay of a trace against a given allocator
+struct ReplayResult
+{
+	double seconds;
+	uint64_t failedAllocations;
+	uint64_t peakLiveBytes;
+	uint64_t rssBefore;
+	uint64_t rssPeak;
+};
+
+bool event_timestamp_less(const bento::AllocationEvent& first, const bento::AllocationEvent& second)
+{
+	return first.timestamp < second.timestamp;
+}
+
+void replay_trace(const bento::Vector<bento::AllocationEvent>& events, uint32_t pointerIdCount, bento::IAllocator& allocator, bento::IAllocator& replayAllocator, ReplayResult& result)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	// Live pointers indexed by their anonymized identifier
+	bento::Vector<void*> pointers(replayAllocator, pointerIdCount);
+	bento::Vector<uint32_t> sizes(replayAllocator, pointerIdCount);
+	for (uint32_t pointerIdx = 0; pointerIdx < pointerIdCount; ++pointerIdx)
+	{
+		pointers[pointerIdx] = nullptr;
+		sizes[pointerIdx] = 0;
+	}
+
+	// The bookkeeping is already resident, only the replay itself is measured
+	result.failedAllocations = 0;
+	result.peakLiveBytes = 0;
+	result.rssBefore = current_resident_memory();
+	reset_peak_resident_memory();
+	uint64_t liveBytes = 0;
+
+	// Events from all the recorded threads are replayed in timestamp order from this thread
+	Clock::time_point start = Clock::now();
+	uint32_t numEvents = events.size();
+	for (uint32_t eventIdx = 0; eventIdx < numEvents; ++eventIdx)
+	{
+		const bento::AllocationEvent& event = events[eventIdx];
+		if (event.type == bento::AllocationEventType::ALLOCATE)
+		{
+			void* ptr = allocator.allocate(event.size, event.alignment);
+			if (ptr == nullptr)
+			{
+				++result.failedAllocations;
+				continue;
+			}
+			pointers[event.pointer_id] = ptr;
+			sizes[event.pointer_id] = event.size;
+			liveBytes += event.size;
+			result.peakLiveBytes = liveBytes > result.peakLiveBytes ? liveBytes : result.peakLiveBytes;
+		}
+		else if (pointers[event.pointer_id] != nullptr)
+		{
+			allocator.deallocate(pointers[event.pointer_id]);
+			pointers[event.pointer_id] = nullptr;
+			liveBytes -= sizes[event.pointer_id];
+		}
+	}
+	Clock::time_point end = Clock::now();
+	result.seconds = std::chrono::duration<double>(end - start).count();
+	result.rssPeak = peak_resident_memory();
+
+	// Release whatever the trace did not free
+	for (uint32_t pointerIdx = 0; pointerIdx < pointerIdCount; ++pointerIdx)
+	{
+		if (pointers[pointerIdx] != nullptr)
+			allocator.deallocate(pointers[pointerIdx]);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 3)
+	{
+		printf("Usage: allocator_replay <trace_file> <system|safe_system|page|book|tlsf>\n");
+		return 1;
+	}
+	const char* tracePath = argv[1];
+	const char* allocatorName = argv[2];
+
+	// Allocator used for the trace itself and the replay bookkeeping
+	bento::SystemAllocator replayAllocator;
+
+	// Load the trace
+	bento::Vector<bento::AllocationEvent> events(replayAllocator);
+	if (!bento::allocation_trace::load(tracePath, events) || events.size() == 0)
+	{
+		bento::default_logger()->log(bento::LogLevel::error, "REPLAY", "Failed to load the allocation trace or the trace is empty.");
+		return 1;
+	}
+
+	// The threads of the recording flush their events independently, restore the global order
+	std::stable_sort(events.begin(), events.end(), event_timestamp_less);
+
+	// Evaluate the biggest request and the number of identifiers of the trace
+	uint32_t numEvents = events.size();
+	uint32_t pointerIdCount = 0;
+	uint32_t maxSize = 0;
+	for (uint32_t eventIdx = 0; eventIdx < numEvents; ++eventIdx)
+	{
+		pointerIdCount = events[eventIdx].pointer_id >= pointerIdCount ? events[eventIdx].pointer_id + 1 : pointerIdCount;
+		maxSize = events[eventIdx].size > maxSize ? events[eventIdx].size : maxSize;
+	}
+	if (maxSize == 0)
+	{
+		bento::default_logger()->log(bento::LogLevel::error, "REPLAY", "The allocation trace doesn't contain any allocation.");
+		return 1;
+	}
+
+	ReplayResult result;
+	if (strcmp(allocatorName, "system") == 0)
+	{
+		bento::SystemAllocator allocator;
+		replay_trace(events, pointerIdCount, allocator, replayAllocator, result);
+	}
+	else if (strcmp(allocatorName, "safe_system") == 0)
+	{
+		bento::SafeSystemAllocator allocator;
+		replay_trace(events, pointerIdCount, allocator, replayAllocator, result);
+	}
+	else if (strcmp(allocatorName, "page") == 0)
+	{
+		// A single page sized for the biggest request and capped to 256MB, traces that need more are rejected and allocations beyond its capacity are reported as failed
+		const uint64_t maxPageSize = 256ull * 1024 * 1024;
+		if ((uint64_t)maxSize * 64 > maxPageSize)
+		{
+			bento::default_logger()->log(bento::LogLevel::error, "REPLAY", "The biggest request of the trace doesn't fit in a 256MB page of at least 64 chunks.");
+			return 1;
+		}
+		uint32_t chunkCount = (uint32_t)((maxPageSize / maxSize) & ~63ull);
+		chunkCount = chunkCount > 4096 ? 4096 : chunkCount;
+		bento::PageAllocator allocator;
+		allocator.initialize(maxSize, chunkCount);
+		replay_trace(events, pointerIdCount, allocator, replayAllocator, result);
+	}
+	else if (strcmp(allocatorName, "book") == 0)
+	{
+		// Growable book with 16 bytes steps up to 256 bytes, bigger requests are reported as failed
+		bento::BookAllocator allocator;
+		bento::book_allocator::initialize(allocator, 16, 256, replayAllocator, 1);
+		replay_trace(events, pointerIdCount, allocator, replayAllocator, result);
+		allocator.release();
+	}
+	else if (strcmp(allocatorName, "tlsf") == 0)
+	{
+		bento::TlsfAllocator allocator;
+		allocator.initialize(replayAllocator, 1024ull * 1024 * 1024);
+		replay_trace(events, pointerIdCount, allocator, replayAllocator, result);
+		allocator.release();
+	}
+	else
+	{
+		bento::default_logger()->log(bento::LogLevel::error, "REPLAY", "Unknown allocator.");
+		return 1;
+	}
+
+	// Fragmentation is the share of the resident memory growth that is not live data at the peak.
+	// The peak working set can't be reset on Windows, so there the growth may also include an earlier peak
+	uint64_t rssGrowth = result.rssPeak > result.rssBefore ? result.rssPeak - result.rssBefore : 0;
+	double fragmentation = rssGrowth > result.peakLiveBytes ? 1.0 - (double)result.peakLiveBytes / (double)rssGrowth : 0.0;
+
+	// One machine readable line per replay
+	printf("allocator=%s events=%u seconds=%f ops_per_second=%f failed_allocations=%llu peak_live_bytes=%llu peak_rss_bytes=%llu fragmentation=%f\n"
+		, allocatorName, numEvents, result.seconds, result.seconds > 0.0 ? numEvents / result.seconds : 0.0
+		, (unsigned long long)result.failedAllocations, (unsigned long long)result.peakLiveBytes
+		, (unsigned long long)result.rssPeak, fragmentation);
+
+	return 0;
+}
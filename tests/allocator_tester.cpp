@@ -2,11 +2,44 @@
 #include <bento_base/log.h>
 #include <bento_base/security.h>
 #include <bento_memory/common.h>
+#include <bento_memory/allocator_stats.h>
+#include <bento_memory/allocator_registry.h>
 #include <bento_memory/page_allocator.h>
+#include <bento_memory/concurrent_page_allocator.h>
+#include <bento_memory/object_pool.h>
 #include <bento_memory/book_allocator.h>
+#include <bento_memory/compacting_pool.h>
+#include <bento_memory/concurrent_book_allocator.h>
+#include <bento_memory/mmap_page_source.h>
+#include <bento_memory/thread_cache_allocator.h>
+#include <bento_memory/static_book.h>
+#include <bento_memory/arena_allocator.h>
+#include <bento_memory/frame_allocator.h>
+#include <bento_memory/heap_profiler.h>
+#include <bento_memory/tlsf_allocator.h>
+#include <bento_memory/trace_allocator.h>
+#include <bento_memory/virtual_memory_allocator.h>
+#include <bento_memory/system_allocator.h>
 #include <bento_memory/safe_system_allocator.h>
+#include <bento_memory/std_allocator.h>
 #include <bento_collection/dynamic_string.h>
 
+// External includes
+#include <atomic>
+#include <chrono>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <memory_resource>
+#if defined(LINUXPC)
+#include <unistd.h>
+#endif
+
 struct TByte4
 {
 	int data;
@@ -32,6 +65,31 @@ struct TByte32
 	float data[8];
 };
 
+struct alignas(32) TSimd32
+{
+	float data[8];
+};
+
+// Fills the whole line, an implicitly padded over-aligned type is a level 4 warning on msvc
+struct alignas(64) TCacheLine64
+{
+	uint64_t counter;
+	uint8_t padding[56];
+};
+
+bool is_aligned(const void* ptr, size_t alignment)
+{
+	return ((uintptr_t)ptr & (alignment - 1)) == 0;
+}
+
+uint32_t count_used_chunks(uint64_t usageFlags)
+{
+	uint32_t usedChunks = 0;
+	for (; usageFlags != 0; usageFlags &= usageFlags - 1)
+		++usedChunks;
+	return usedChunks;
+}
+
 void test_page_allocator()
 {
 	// Create an allocator that allocates 16 bytes per chunk
@@ -117,6 +175,268 @@ void test_page_allocator()
 	}
 }
 
+void test_large_page_allocator(uint32_t chunkCount)
+{
+	// Create an allocator that allocates 16 bytes per chunk, tracked by a two-level bitmap
+	bento::PageAllocator pageAllocator;
+	pageAllocator.initialize(16, chunkCount);
+	assert(pageAllocator.chunk_count() == chunkCount);
+	assert(pageAllocator.memory_footprint() == (16 * chunkCount));
+	assert(pageAllocator.used_chunk_count() == 0);
+
+	// Allocate every chunk of the page
+	bento::SystemAllocator systemAllocator;
+	bento::Vector<TByte16*> c(systemAllocator, chunkCount);
+	for (uint32_t chunkIdx = 0; chunkIdx < chunkCount; ++chunkIdx)
+	{
+		c[chunkIdx] = bento::make_new<TByte16>(pageAllocator);
+		assert(c[chunkIdx] != nullptr);
+	}
+	assert(pageAllocator.used_chunk_count() == chunkCount);
+	assert(pageAllocator.is_full());
+
+	TByte16* tooMuch = bento::make_new<TByte16>(pageAllocator);
+	assert(tooMuch == nullptr);
+
+	// Free a chunk in the middle of the last leaf word, it must be the only one available
+	uint32_t lastWordChunk = chunkCount - 37;
+	bento::make_delete<TByte16>(pageAllocator, c[lastWordChunk]);
+	assert(!pageAllocator.is_full());
+	assert(pageAllocator.leaf_usage_flags(lastWordChunk / 64) == ~(1ull << (lastWordChunk % 64)));
+	TByte16* lastWordChunkBis = bento::make_new<TByte16>(pageAllocator);
+	assert(lastWordChunkBis == c[lastWordChunk]);
+	c[lastWordChunk] = lastWordChunkBis;
+
+	// Free a chunk per leaf word, they must be re-attributed lowest first
+	for (uint32_t chunkIdx = 5; chunkIdx < chunkCount; chunkIdx += 64)
+		bento::make_delete<TByte16>(pageAllocator, c[chunkIdx]);
+	assert(pageAllocator.used_chunk_count() == chunkCount - chunkCount / 64);
+	for (uint32_t chunkIdx = 5; chunkIdx < chunkCount; chunkIdx += 64)
+	{
+		TByte16* chunk = bento::make_new<TByte16>(pageAllocator);
+		assert(chunk == c[chunkIdx]);
+	}
+	assert(pageAllocator.is_full());
+
+	// Free all the data (top to bottom this time)
+	for (int32_t chunkIdx = chunkCount - 1; chunkIdx >= 0; --chunkIdx)
+		bento::make_delete<TByte16>(pageAllocator, c[chunkIdx]);
+
+	// Make sure everything was freed
+	assert(pageAllocator.used_chunk_count() == 0);
+	for (uint32_t wordIdx = 0; wordIdx < chunkCount / 64; ++wordIdx)
+		assert(pageAllocator.leaf_usage_flags(wordIdx) == 0x0000000000);
+}
+
+void test_concurrent_page_allocator()
+{
+	// Create an allocator that allocates 16 bytes per chunk
+	bento::ConcurrentPageAllocator pageAllocator;
+	pageAllocator.initialize(16);
+	assert(pageAllocator.memory_footprint() == (16 * 64));
+
+	// Single threaded usage must behave exactly like the regular page allocator
+	{
+		TByte16* c0 = bento::make_new<TByte16>(pageAllocator);
+		TByte16* c1 = bento::make_new<TByte16>(pageAllocator);
+		TByte16* c2 = bento::make_new<TByte16>(pageAllocator);
+		assert(c0 != nullptr && c1 != nullptr && c2 != nullptr);
+		assert(pageAllocator.usage_flags() == 0x00000007);
+
+		bento::make_delete<TByte16>(pageAllocator, c1);
+		assert(pageAllocator.usage_flags() == 0x00000005);
+
+		TByte16* c1_bis = bento::make_new<TByte16>(pageAllocator);
+		assert(c1_bis == c1);
+		assert(pageAllocator.usage_flags() == 0x00000007);
+
+		bento::make_delete<TByte16>(pageAllocator, c0);
+		bento::make_delete<TByte16>(pageAllocator, c1_bis);
+		bento::make_delete<TByte16>(pageAllocator, c2);
+		assert(pageAllocator.usage_flags() == 0x0000000000);
+	}
+
+	const uint32_t numThreads = 8;
+	const uint32_t numIterations = 10000;
+
+	// Every thread keeps a few chunks alive, stamps them and makes sure nobody else got handed the same chunk
+	{
+		std::atomic<uint32_t> corruptedChunks(0);
+		std::thread threads[numThreads];
+		for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+		{
+			threads[threadIdx] = std::thread([&pageAllocator, &corruptedChunks, threadIdx]()
+			{
+				TByte4* chunks[4];
+				for (uint32_t iteration = 0; iteration < numIterations; ++iteration)
+				{
+					// 8 threads holding 4 chunks each never exceed the 64 chunks of the page
+					for (uint32_t chunkIdx = 0; chunkIdx < 4; ++chunkIdx)
+					{
+						chunks[chunkIdx] = bento::make_new<TByte4>(pageAllocator);
+						assert(chunks[chunkIdx] != nullptr);
+						chunks[chunkIdx]->data = (int)(threadIdx * 4 + chunkIdx);
+					}
+
+					for (uint32_t chunkIdx = 0; chunkIdx < 4; ++chunkIdx)
+					{
+						if (chunks[chunkIdx]->data != (int)(threadIdx * 4 + chunkIdx))
+							corruptedChunks.fetch_add(1);
+						bento::make_delete<TByte4>(pageAllocator, chunks[chunkIdx]);
+					}
+				}
+			});
+		}
+		for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+			threads[threadIdx].join();
+
+		// No chunk was handed twice and every claimed bit was released
+		assert(corruptedChunks.load() == 0);
+		assert(pageAllocator.usage_flags() == 0x0000000000);
+	}
+
+	// All the threads race for the 64 chunks of the page, each of them must be claimed exactly once
+	{
+		TByte16* c[numThreads][64];
+		uint32_t claimed[numThreads];
+		std::thread threads[numThreads];
+		for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+		{
+			threads[threadIdx] = std::thread([&pageAllocator, &c, &claimed, threadIdx]()
+			{
+				claimed[threadIdx] = 0;
+				while (TByte16* chunk = bento::make_new<TByte16>(pageAllocator))
+					c[threadIdx][claimed[threadIdx]++] = chunk;
+			});
+		}
+		for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+			threads[threadIdx].join();
+
+		// The first chunk of the page is the lowest address that was handed out
+		uint32_t totalClaimed = 0;
+		char* pageStart = nullptr;
+		for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+		{
+			totalClaimed += claimed[threadIdx];
+			for (uint32_t chunkIdx = 0; chunkIdx < claimed[threadIdx]; ++chunkIdx)
+			{
+				char* chunk = (char*)c[threadIdx][chunkIdx];
+				pageStart = (pageStart == nullptr || chunk < pageStart) ? chunk : pageStart;
+			}
+		}
+		assert(totalClaimed == 64);
+		assert(pageAllocator.is_full());
+
+		// Make sure that no chunk was given twice
+		uint64_t claimedFlags = 0;
+		for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+		{
+			for (uint32_t chunkIdx = 0; chunkIdx < claimed[threadIdx]; ++chunkIdx)
+			{
+				uint64_t chunkBit = 1ull << (((char*)c[threadIdx][chunkIdx] - pageStart) / 16);
+				assert((claimedFlags & chunkBit) == 0);
+				claimedFlags |= chunkBit;
+			}
+		}
+		assert(claimedFlags == pageAllocator.usage_flags());
+
+		// Free everything concurrently
+		for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+		{
+			threads[threadIdx] = std::thread([&pageAllocator, &c, &claimed, threadIdx]()
+			{
+				for (uint32_t chunkIdx = 0; chunkIdx < claimed[threadIdx]; ++chunkIdx)
+					bento::make_delete<TByte16>(pageAllocator, c[threadIdx][chunkIdx]);
+			});
+		}
+		for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+			threads[threadIdx].join();
+
+		// Make sure everything was freed
+		assert(pageAllocator.usage_flags() == 0x0000000000);
+	}
+}
+
+void test_object_pool()
+{
+	// Handles pack the slot index and its generation in 32 bits
+	assert(sizeof(bento::PoolHandle) == 4);
+
+	bento::ObjectPool<TByte16> objectPool;
+	objectPool.initialize(256);
+	assert(objectPool.size() == 0);
+
+	// Tests that a recycled slot doesn't resolve through a stale handle
+	{
+		bento::PoolHandle c0 = objectPool.create();
+		bento::PoolHandle c1 = objectPool.create();
+		assert(objectPool.resolve(c0) != nullptr);
+		assert(objectPool.resolve(c1) != nullptr);
+		assert(objectPool.size() == 2);
+
+		objectPool.destroy(c1);
+		assert(objectPool.resolve(c1) == nullptr);
+
+		// The freed slot is reused, but with a new generation
+		bento::PoolHandle c1_bis = objectPool.create();
+		assert(bento::pool_handle::index(c1_bis) == bento::pool_handle::index(c1));
+		assert(bento::pool_handle::generation(c1_bis) != bento::pool_handle::generation(c1));
+		assert(objectPool.resolve(c1) == nullptr);
+		assert(objectPool.resolve(c1_bis) != nullptr);
+
+		// Destroying through a stale handle is rejected
+		bool destroyed = objectPool.destroy(c1);
+		assert(!destroyed);
+		assert(objectPool.size() == 2);
+
+		objectPool.destroy(c0);
+		objectPool.destroy(c1_bis);
+		assert(objectPool.size() == 0);
+	}
+
+	// Tests that the live objects are stored densely for batch processing
+	{
+		bento::PoolHandle handles[100];
+		for (uint32_t objectIdx = 0; objectIdx < 100; ++objectIdx)
+		{
+			handles[objectIdx] = objectPool.create();
+			objectPool.resolve(handles[objectIdx])->data[0] = (objectIdx % 2) == 0;
+		}
+
+		// Remove every odd object, the remaining ones stay packed
+		for (uint32_t objectIdx = 1; objectIdx < 100; objectIdx += 2)
+			objectPool.destroy(handles[objectIdx]);
+		assert(objectPool.size() == 50);
+		uint32_t liveObjects = 0;
+		for (TByte16* object = objectPool.begin(); object != objectPool.end(); ++object, ++liveObjects)
+			assert(object->data[0]);
+		assert(liveObjects == 50);
+		assert(objectPool.end() - objectPool.begin() == 50);
+
+		// Handles still resolve to the right objects after the packing
+		for (uint32_t objectIdx = 0; objectIdx < 100; objectIdx += 2)
+			assert(objectPool.resolve(handles[objectIdx])->data[0]);
+
+		for (uint32_t objectIdx = 0; objectIdx < 100; objectIdx += 2)
+			objectPool.destroy(handles[objectIdx]);
+		assert(objectPool.size() == 0);
+	}
+
+	// Tests that the pool refuses to grow beyond its capacity
+	{
+		bento::ObjectPool<TByte4> smallPool;
+		smallPool.initialize(64);
+		for (uint32_t objectIdx = 0; objectIdx < 64; ++objectIdx)
+		{
+			bento::PoolHandle handle = smallPool.create();
+			assert(handle != bento::pool_handle::invalid());
+		}
+		bento::PoolHandle overflow = smallPool.create();
+		assert(overflow == bento::pool_handle::invalid());
+		assert(smallPool.size() == 64);
+	}
+}
+
 void test_book_allocator()
 {
 	bento::BookAllocator bookAllocator;
@@ -128,13 +448,34 @@ void test_book_allocator()
 	bento::PageAllocator& page2 = bookAllocator.get_page_allocator(2);
 	bento::PageAllocator& page3 = bookAllocator.get_page_allocator(3);
 
-	// Check the memory footprint
-	uint32_t headerSize = bookAllocator.header_size();
-	assert(page0.memory_footprint() == ((4 + headerSize) * 64));
-	assert(page1.memory_footprint() == ((8 + headerSize) * 64));
-	assert(page2.memory_footprint() == ((12 + headerSize) * 64));
-	assert(page3.memory_footprint() == ((16 + headerSize) * 64));
-	assert(bookAllocator.memory_footprint() == ((4 + 8 + 12 + 16 + headerSize * 4) * 64));
+	// Check the memory footprint, the owning page is found from the address so chunks carry no header
+	assert(bookAllocator.header_size() == 0);
+	assert(page0.memory_footprint() == (4 * 64));
+	assert(page1.memory_footprint() == (8 * 64));
+	assert(page2.memory_footprint() == (12 * 64));
+	assert(page3.memory_footprint() == (16 * 64));
+	assert(bookAllocator.memory_footprint() == ((4 + 8 + 12 + 16) * 64));
+
+	// Check the precomputed size class routing
+	assert(bookAllocator.size_class(1) == 0);
+	assert(bookAllocator.size_class(sizeof(TByte4)) == 0);
+	assert(bookAllocator.size_class(5) == 1);
+	assert(bookAllocator.size_class(sizeof(TByte8)) == 1);
+	assert(bookAllocator.size_class(sizeof(TByte12)) == 2);
+	assert(bookAllocator.size_class(sizeof(TByte16)) == 3);
+
+	// Test that the owning page is retrieved by masking the address of a chunk
+	{
+		TByte4* byte4 = bento::make_new<TByte4>(bookAllocator);
+		TByte12* byte12 = bento::make_new<TByte12>(bookAllocator);
+		TByte16* byte16 = bento::make_new<TByte16>(bookAllocator);
+		assert(bookAllocator.page_allocator_from_pointer(byte4) == &page0);
+		assert(bookAllocator.page_allocator_from_pointer(byte12) == &page2);
+		assert(bookAllocator.page_allocator_from_pointer(byte16) == &page3);
+		bento::make_delete<TByte16>(bookAllocator, byte16);
+		bento::make_delete<TByte12>(bookAllocator, byte12);
+		bento::make_delete<TByte4>(bookAllocator, byte4);
+	}
 
 	// Test that the allocations fall into the right page (if can)
 	{
@@ -254,110 +595,1652 @@ void test_book_allocator()
 	}
 }
 
-void assert_memory_usage(bento::SafeSystemAllocator& allocator, uint32_t current, uint32_t total_allocated, uint32_t total_freed)
+void test_static_book()
 {
-	assert(allocator.current_allocated_memory() == current);
-	assert(allocator.total_memory_allocated() == total_allocated);
-	assert(allocator.total_freed_memory() == total_freed);
-}
+	typedef bento::StaticBook<4, 8, 12, 16> TestBook;
 
-void test_safe_system_allocator()
-{
+	// The size classes are resolved at compile time
+	static_assert(TestBook::size_class_count == 4, "Unexpected number of size classes");
+	static_assert(TestBook::size_class(sizeof(TByte4)) == 0, "TByte4 should land in the 4 bytes class");
+	static_assert(TestBook::size_class(sizeof(TByte8)) == 1, "TByte8 should land in the 8 bytes class");
+	static_assert(TestBook::size_class(sizeof(TByte12)) == 2, "TByte12 should land in the 12 bytes class");
+	static_assert(TestBook::size_class(sizeof(TByte16)) == 3, "TByte16 should land in the 16 bytes class");
+	static_assert(TestBook::size_class(5) == 1, "5 bytes should be rounded to the 8 bytes class");
+
+	TestBook book;
+	book.initialize();
+	bento::PageAllocator& page0 = book.get_page_allocator(0);
+	bento::PageAllocator& page2 = book.get_page_allocator(2);
+	bento::PageAllocator& page3 = book.get_page_allocator(3);
+	assert(book.memory_footprint() == ((4 + 8 + 12 + 16) * 64));
+
+	// Tests that make_new goes straight to the page of the size class
 	{
-		bento::SafeSystemAllocator safeMemoryAllocator;
-		assert_memory_usage(safeMemoryAllocator, 0, 0, 0);
-		uint32_t headerSize = safeMemoryAllocator.header_size();
+		TByte12* c12 = bento::make_new<TByte12>(book);
+		assert(c12 != nullptr);
+		assert(page2.usage_flags() == 0x00000001);
+		bento::make_delete<TByte12>(book, c12);
+		assert(page2.usage_flags() == 0x0000000000);
+	}
 
-		TByte4* c4 = bento::make_new<TByte4>(safeMemoryAllocator);
-		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) + headerSize), (sizeof(TByte4) + headerSize), 0);
+	// Tests that a full size class doesn't spill into the next one
+	{
+		TByte4* c[64];
+		for (uint32_t chunkIdx = 0; chunkIdx < 64; ++chunkIdx)
+		{
+			c[chunkIdx] = bento::make_new<TByte4>(book);
+			assert(c[chunkIdx] != nullptr);
+		}
+		assert(page0.is_full());
 
-		TByte8* c8 = bento::make_new<TByte8>(safeMemoryAllocator);
-		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) + sizeof(TByte8) + headerSize * 2), (sizeof(TByte4) + sizeof(TByte8) + headerSize * 2), 0);
+		TByte4* tooMuch = bento::make_new<TByte4>(book);
+		assert(tooMuch == nullptr);
+		assert(book.get_page_allocator(1).usage_flags() == 0x0000000000);
 
-		TByte32* c32 = bento::make_new<TByte32>(safeMemoryAllocator);
-		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3), (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3), 0);
+		for (int32_t chunkIdx = 63; chunkIdx >= 0; --chunkIdx)
+			bento::make_delete<TByte4>(book, c[chunkIdx]);
+		assert(page0.usage_flags() == 0x0000000000);
+	}
 
-		bento::make_delete<TByte4>(safeMemoryAllocator, c4);
-		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte8) + sizeof(TByte32) + headerSize * 2), (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3), sizeof(TByte4) + headerSize);
+	// Tests that the book still works through the generic interface, with the runtime routing
+	{
+		bento::IAllocator& allocator = book;
+		void* block = allocator.allocate(13, 4);
+		assert(block != nullptr);
+		assert(page3.usage_flags() == 0x00000001);
+		allocator.deallocate(block);
+		assert(page3.usage_flags() == 0x0000000000);
 
-		bento::make_delete<TByte8>(safeMemoryAllocator, c8);
-		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte32) + headerSize), (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3), (sizeof(TByte4) + sizeof(TByte8) + headerSize * 2));
+		void* tooBig = allocator.allocate(sizeof(TByte32), 4);
+		assert(tooBig == nullptr);
+	}
+}
 
-		bento::make_delete<TByte32>(safeMemoryAllocator, c32);
-		assert_memory_usage(safeMemoryAllocator, 0, (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3), (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3));
+void test_growable_book_allocator()
+{
+	// Pages are pulled from this allocator when a size class runs out of chunks
+	bento::SafeSystemAllocator backingAllocator;
+
+	// Create a book that keeps at most one empty page per size class
+	bento::BookAllocator bookAllocator;
+	bento::book_allocator::initialize(bookAllocator, 4, 16, backingAllocator, 1);
+	for (uint32_t classIdx = 0; classIdx < 4; ++classIdx)
+		assert(bookAllocator.page_count(classIdx) == 1);
+	uint64_t initialMemory = backingAllocator.current_allocated_memory();
+
+	// Test that a full size class grows instead of returning null or spilling into the next one
+	{
+		// Fill exactly four pages
+		TByte4* c[256];
+		for (uint32_t chunkIdx = 0; chunkIdx < 256; ++chunkIdx)
+		{
+			c[chunkIdx] = bento::make_new<TByte4>(bookAllocator);
+			assert(c[chunkIdx] != nullptr);
+		}
+		assert(bookAllocator.page_count(0) == 4);
+		assert(bookAllocator.page_count(1) == 1);
+		assert(bookAllocator.get_page_allocator(1).usage_flags() == 0x0000000000);
+		assert(backingAllocator.current_allocated_memory() > initialMemory);
+
+		// Free a single chunk, the next allocation must reuse it rather than growing
+		TByte4* reused = c[10];
+		bento::make_delete<TByte4>(bookAllocator, c[10]);
+		c[10] = bento::make_new<TByte4>(bookAllocator);
+		assert(c[10] == reused);
+		assert(bookAllocator.page_count(0) == 4);
+
+		// Free all the data (top to bottom this time)
+		for (int32_t chunkIdx = 255; chunkIdx >= 0; --chunkIdx)
+			bento::make_delete<TByte4>(bookAllocator, c[chunkIdx]);
+
+		// The empty pages above the watermark have been released to the backing allocator
+		assert(bookAllocator.page_count(0) == 1);
+		assert(bookAllocator.get_page_allocator(0).usage_flags() == 0x0000000000);
+		assert(backingAllocator.current_allocated_memory() == initialMemory);
 	}
 
+	// Test that every size class grows independently
 	{
-		bento::SafeSystemAllocator safeMemoryAllocator;
-		assert_memory_usage(safeMemoryAllocator, 0, 0, 0);
-		uint32_t headerSize = safeMemoryAllocator.header_size();
+		TByte8* c8[100];
+		TByte16* c16[100];
+		for (uint32_t chunkIdx = 0; chunkIdx < 100; ++chunkIdx)
+		{
+			c8[chunkIdx] = bento::make_new<TByte8>(bookAllocator);
+			c16[chunkIdx] = bento::make_new<TByte16>(bookAllocator);
+			assert(c8[chunkIdx] != nullptr);
+			assert(c16[chunkIdx] != nullptr);
+		}
+		assert(bookAllocator.page_count(0) == 1);
+		assert(bookAllocator.page_count(1) == 2);
+		assert(bookAllocator.page_count(2) == 1);
+		assert(bookAllocator.page_count(3) == 2);
 
-		TByte4* c4 = bento::make_new<TByte4>(safeMemoryAllocator);
-		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) + headerSize), (sizeof(TByte4) + headerSize), 0);
+		for (int32_t chunkIdx = 99; chunkIdx >= 0; --chunkIdx)
+		{
+			bento::make_delete<TByte16>(bookAllocator, c16[chunkIdx]);
+			bento::make_delete<TByte8>(bookAllocator, c8[chunkIdx]);
+		}
+		assert(bookAllocator.page_count(1) == 1);
+		assert(bookAllocator.page_count(3) == 1);
+		assert(backingAllocator.current_allocated_memory() == initialMemory);
+	}
 
-		bento::make_delete<TByte4>(safeMemoryAllocator, c4);
-		assert_memory_usage(safeMemoryAllocator, 0, (sizeof(TByte4) + headerSize), (sizeof(TByte4) + headerSize));
+	// Chunks bigger than the biggest size class still can't be served
+	TByte32* byte32 = bento::make_new<TByte32>(bookAllocator);
+	assert(byte32 == nullptr);
 
-		TByte8* c8 = bento::make_new<TByte8>(safeMemoryAllocator);
-		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte8) + headerSize), (sizeof(TByte4) + sizeof(TByte8) + headerSize * 2), (sizeof(TByte4) + headerSize));
+	// Make sure the initial pages are given back too
+	bookAllocator.release();
+	assert(backingAllocator.current_allocated_memory() == 0);
+}
 
-		bento::make_delete<TByte8>(safeMemoryAllocator, c8);
-		assert_memory_usage(safeMemoryAllocator, 0, (sizeof(TByte4) + sizeof(TByte8) + headerSize * 2), (sizeof(TByte4) + sizeof(TByte8) + headerSize * 2));
+#if defined(LINUXPC)
+void test_mmap_page_source()
+{
+	// Ask for huge pages, the source must silently fall back to regular pages if the system has none
+	bento::MmapPageSource pageSource;
+	pageSource.initialize(bento::PageSourceFlags::HUGE_PAGES);
+	assert(pageSource.page_size() >= 4096);
+	assert(pageSource.mapped_memory() == 0);
 
-		TByte32* c32 = bento::make_new<TByte32>(safeMemoryAllocator);
-		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte32) + headerSize), (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3), (sizeof(TByte4) + sizeof(TByte8) + headerSize * 2));
+	// Tests that the mapped memory is usable and that idle pages are returned to the system
+	{
+		size_t regionSize = 2 * 1024 * 1024;
+		char* region = (char*)pageSource.map_pages(regionSize);
+		assert(region != nullptr);
+		assert(((uintptr_t)region % pageSource.page_size()) == 0);
+		assert(pageSource.mapped_memory() == regionSize);
+		for (size_t byteIdx = 0; byteIdx < regionSize; byteIdx += 4096)
+			region[byteIdx] = 1;
 
-		bento::make_delete<TByte32>(safeMemoryAllocator, c32);
-		assert_memory_usage(safeMemoryAllocator, 0, (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3), (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3));
+		// The range stays mapped but its content is dropped. Before Linux 5.18, madvise can't drop hugetlb pages,
+		// so the content is only checked when the source fell back to regular pages
+		pageSource.decommit_pages(region, regionSize);
+		assert(pageSource.mapped_memory() == regionSize);
+		if (pageSource.page_size() == (size_t)sysconf(_SC_PAGESIZE))
+		{
+			for (size_t byteIdx = 0; byteIdx < regionSize; byteIdx += 4096)
+				assert(region[byteIdx] == 0);
+		}
+
+		pageSource.unmap_pages(region, regionSize);
+		assert(pageSource.mapped_memory() == 0);
 	}
 
+	// Tests that a page allocator can draw its page from the source
 	{
-		bento::SafeSystemAllocator safeMemoryAllocator;
-		assert_memory_usage(safeMemoryAllocator, 0, 0, 0);
-		uint32_t headerSize = safeMemoryAllocator.header_size();
+		bento::PageAllocator pageAllocator;
+		pageAllocator.initialize(16, 64, pageSource);
+		assert(pageSource.mapped_memory() >= pageAllocator.memory_footprint());
 
-		bento::Vector<TByte4> vc4(safeMemoryAllocator);
-		bento::Vector<TByte8> vc8(safeMemoryAllocator);
-		bento::Vector<TByte16> vc16(safeMemoryAllocator);
+		TByte16* c0 = bento::make_new<TByte16>(pageAllocator);
+		assert(c0 != nullptr);
+		assert(pageAllocator.usage_flags() == 0x00000001);
+		bento::make_delete<TByte16>(pageAllocator, c0);
 
-		vc4.resize(4);
-		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) * 4 + headerSize), (sizeof(TByte4) * 4 + headerSize), 0);
-		vc8.resize(4);
-		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) * 4 + sizeof(TByte8) * 4 + headerSize * 2), (sizeof(TByte4) * 4 + sizeof(TByte8) * 4 + headerSize * 2), 0);
-		vc16.resize(4);
-		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) * 4 + sizeof(TByte8) * 4 + sizeof(TByte16) * 4 + headerSize * 3), (sizeof(TByte4) * 4 + sizeof(TByte8) * 4 + sizeof(TByte16) * 4 + headerSize * 3), 0);
+		pageAllocator.release();
+		assert(pageSource.mapped_memory() == 0);
+	}
 
-		vc4.free();
-		vc4.resize(8);
-		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) * 8 + sizeof(TByte8) * 4 + sizeof(TByte16) * 4 + headerSize * 3), (sizeof(TByte4) * 12 + sizeof(TByte8) * 4 + sizeof(TByte16) * 4 + headerSize * 4), (sizeof(TByte4) * 4 + headerSize));
-		vc8.free();
-		vc8.resize(8);
-		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) * 8 + sizeof(TByte8) * 8 + sizeof(TByte16) * 4 + headerSize * 3), (sizeof(TByte4) * 12 + sizeof(TByte8) * 12 + sizeof(TByte16) * 4 + headerSize * 5), (sizeof(TByte4) * 4 + sizeof(TByte8) * 4 + headerSize * 2 ));
-		vc16.free();
-		vc16.resize(8);
-		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) * 8 + sizeof(TByte8) * 8 + sizeof(TByte16) * 8 + headerSize * 3), (sizeof(TByte4) * 12 + sizeof(TByte8) * 12 + sizeof(TByte16) * 12 + headerSize * 6), (sizeof(TByte4) * 4 + sizeof(TByte8) * 4 + sizeof(TByte16) * 4 + headerSize * 3));
+	// Tests that a book allocator can draw all its pages from the source
+	{
+		bento::BookAllocator bookAllocator;
+		bento::book_allocator::initialize(bookAllocator, 4, 16, pageSource);
+		assert(pageSource.mapped_memory() >= bookAllocator.memory_footprint());
+
+		TByte12* c12 = bento::make_new<TByte12>(bookAllocator);
+		assert(c12 != nullptr);
+		assert(bookAllocator.get_page_allocator(2).usage_flags() == 0x00000001);
+		bento::make_delete<TByte12>(bookAllocator, c12);
+
+		bookAllocator.release();
+		assert(pageSource.mapped_memory() == 0);
 	}
+}
+#endif
 
+void fragment_compacting_pool(bento::CompactingPool& compactingPool, bento::CompactingHandle* handles, uint32_t numHandles)
+{
+	// Fill the pages
+	for (uint32_t chunkIdx = 0; chunkIdx < numHandles; ++chunkIdx)
 	{
-		bento::SafeSystemAllocator safeMemoryAllocator;
-		bento::DynamicString* string = bento::make_new<bento::DynamicString>(safeMemoryAllocator, safeMemoryAllocator);
-		string->resize(1000);
-		bento::make_delete<bento::DynamicString>(safeMemoryAllocator, string);
+		handles[chunkIdx] = compactingPool.allocate();
+		TByte16* chunk = (TByte16*)compactingPool.resolve(handles[chunkIdx]);
+		assert(chunk != nullptr);
+		chunk->data[0] = (chunkIdx % 64) == 0;
+	}
+
+	// Keep a single live chunk per page, which pins every page
+	for (uint32_t chunkIdx = 0; chunkIdx < numHandles; ++chunkIdx)
+	{
+		if ((chunkIdx % 64) != 0)
+			compactingPool.free(handles[chunkIdx]);
 	}
+	assert(compactingPool.page_count() == numHandles / 64);
 }
 
-int main()
+void test_compacting_pool()
 {
-	bento::default_logger()->log(bento::LogLevel::info, "TESTS", "Running allocators tests.");
+	bento::SafeSystemAllocator backingAllocator;
 
-	// Run the page allocator tests
-	test_page_allocator();
+	// Create a pool of 16 bytes chunks, 64 per page
+	bento::CompactingPool compactingPool;
+	compactingPool.initialize(backingAllocator, 16, 64);
+	bento::CompactingHandle handles[640];
 
-	// Run the book allocator tests
-	test_book_allocator();
+	// Tests that a full compaction relocates the survivors and releases the emptied pages
+	{
+		fragment_compacting_pool(compactingPool, handles, 640);
+		uint64_t fragmentedMemory = backingAllocator.current_allocated_memory();
 
-	// Run the book allocator tests
-	test_safe_system_allocator();
+		compactingPool.compact();
+		assert(compactingPool.page_count() == 1);
+		assert(backingAllocator.current_allocated_memory() < fragmentedMemory);
+
+		// The handles follow the relocated objects
+		for (uint32_t chunkIdx = 0; chunkIdx < 640; chunkIdx += 64)
+		{
+			TByte16* chunk = (TByte16*)compactingPool.resolve(handles[chunkIdx]);
+			assert(chunk != nullptr && chunk->data[0]);
+			compactingPool.free(handles[chunkIdx]);
+		}
+		assert(compactingPool.live_count() == 0);
+	}
+
+	// Tests that the compaction can be spread over several calls with a time budget
+	{
+		fragment_compacting_pool(compactingPool, handles, 640);
+
+		// Each step moves at least one object, so this always converges
+		uint32_t numSteps = 0;
+		while (!compactingPool.compact(0))
+		{
+			++numSteps;
+			assert(numSteps < 640);
+		}
+		assert(numSteps > 0);
+		assert(compactingPool.page_count() == 1);
+
+		for (uint32_t chunkIdx = 0; chunkIdx < 640; chunkIdx += 64)
+		{
+			TByte16* chunk = (TByte16*)compactingPool.resolve(handles[chunkIdx]);
+			assert(chunk != nullptr && chunk->data[0]);
+			compactingPool.free(handles[chunkIdx]);
+		}
+	}
+
+	// Make sure all the pages are released
+	compactingPool.release();
+	assert(backingAllocator.current_allocated_memory() == 0);
+}
+
+void test_thread_cache_allocator()
+{
+	bento::BookAllocator bookAllocator;
+	bento::book_allocator::initialize(bookAllocator, 4, 16);
+	bento::PageAllocator& page0 = bookAllocator.get_page_allocator(0);
+	bento::PageAllocator& page1 = bookAllocator.get_page_allocator(1);
+	bento::PageAllocator& page2 = bookAllocator.get_page_allocator(2);
+	bento::PageAllocator& page3 = bookAllocator.get_page_allocator(3);
+
+	// Put a cache with 8 chunks per magazine in front of the book
+	bento::ThreadCacheAllocator cacheAllocator;
+	cacheAllocator.initialize(bookAllocator, 8);
+	assert(cacheAllocator.magazine_size() == 8);
+
+	// Tests that the magazines are refilled and flushed in batches
+	{
+		// The first allocation refills the whole magazine of the size class
+		TByte4* c0 = bento::make_new<TByte4>(cacheAllocator);
+		assert(c0 != nullptr);
+		assert(count_used_chunks(page0.usage_flags()) == 8);
+
+		// The next allocations are served by the magazine without touching the book
+		TByte4* c[7];
+		for (uint32_t chunkIdx = 0; chunkIdx < 7; ++chunkIdx)
+		{
+			c[chunkIdx] = bento::make_new<TByte4>(cacheAllocator);
+			assert(c[chunkIdx] != nullptr);
+		}
+		assert(count_used_chunks(page0.usage_flags()) == 8);
+
+		// Other size classes have their own magazines
+		TByte8* c8 = bento::make_new<TByte8>(cacheAllocator);
+		assert(c8 != nullptr);
+		assert(count_used_chunks(page1.usage_flags()) == 8);
+		assert(count_used_chunks(page0.usage_flags()) == 8);
+
+		// Freed chunks go back to the magazine, not to the book
+		bento::make_delete<TByte4>(cacheAllocator, c0);
+		for (uint32_t chunkIdx = 0; chunkIdx < 7; ++chunkIdx)
+			bento::make_delete<TByte4>(cacheAllocator, c[chunkIdx]);
+		bento::make_delete<TByte8>(cacheAllocator, c8);
+		assert(count_used_chunks(page0.usage_flags()) == 8);
+		assert(count_used_chunks(page1.usage_flags()) == 8);
+
+		// Flushing the thread cache returns everything to the book
+		cacheAllocator.flush();
+		assert(page0.usage_flags() == 0x0000000000);
+		assert(page1.usage_flags() == 0x0000000000);
+	}
+
+	// Tests that an overflowing magazine gets flushed back to the book
+	{
+		// Hold more chunks than a magazine can contain
+		TByte16* c[24];
+		for (uint32_t chunkIdx = 0; chunkIdx < 24; ++chunkIdx)
+		{
+			c[chunkIdx] = bento::make_new<TByte16>(cacheAllocator);
+			assert(c[chunkIdx] != nullptr);
+		}
+		assert(count_used_chunks(page3.usage_flags()) == 24);
+
+		// Once the magazine overflows, the extra chunks are released to the book
+		for (uint32_t chunkIdx = 0; chunkIdx < 24; ++chunkIdx)
+			bento::make_delete<TByte16>(cacheAllocator, c[chunkIdx]);
+		assert(count_used_chunks(page3.usage_flags()) <= 2 * cacheAllocator.magazine_size());
+
+		cacheAllocator.flush();
+		assert(page3.usage_flags() == 0x0000000000);
+	}
+
+	// Tests that the cache can be used anywhere a book allocator is used
+	{
+		bento::IAllocator& allocator = cacheAllocator;
+		bento::Vector<TByte4> vc4(allocator);
+		vc4.resize(2);
+		vc4[0].data = 0;
+		vc4[1].data = 1;
+		assert(vc4[0].data == 0 && vc4[1].data == 1);
+		vc4.free();
+		cacheAllocator.flush();
+		assert(page1.usage_flags() == 0x0000000000);
+	}
+
+	// Every thread churns through its own magazines and flushes them before leaving
+	{
+		const uint32_t numThreads = 4;
+		std::atomic<uint32_t> failedAllocations(0);
+		std::thread threads[numThreads];
+		for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+		{
+			threads[threadIdx] = std::thread([&cacheAllocator, &failedAllocations]()
+			{
+				for (uint32_t iteration = 0; iteration < 10000; ++iteration)
+				{
+					TByte4* c4 = bento::make_new<TByte4>(cacheAllocator);
+					TByte12* c12 = bento::make_new<TByte12>(cacheAllocator);
+					if (c4 == nullptr || c12 == nullptr)
+						failedAllocations.fetch_add(1);
+					bento::make_delete<TByte12>(cacheAllocator, c12);
+					bento::make_delete<TByte4>(cacheAllocator, c4);
+				}
+				cacheAllocator.flush();
+			});
+		}
+		for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+			threads[threadIdx].join();
+
+		// Make sure everything was given back to the book
+		assert(failedAllocations.load() == 0);
+		assert(page0.usage_flags() == 0x0000000000);
+		assert(page1.usage_flags() == 0x0000000000);
+		assert(page2.usage_flags() == 0x0000000000);
+		assert(page3.usage_flags() == 0x0000000000);
+	}
+}
+
+void assert_memory_usage(bento::SafeSystemAllocator& allocator, uint32_t current, uint32_t total_allocated, uint32_t total_freed)
+{
+	assert(allocator.current_allocated_memory() == current);
+	assert(allocator.total_memory_allocated() == total_allocated);
+	assert(allocator.total_freed_memory() == total_freed);
+}
+
+void test_concurrent_safe_system_allocator()
+{
+	const uint32_t numThreads = 8;
+	const uint32_t numIterations = 10000;
+
+	bento::SafeSystemAllocator safeMemoryAllocator;
+	uint32_t headerSize = safeMemoryAllocator.header_size();
+
+	// Every thread churns and keeps one structure alive, the statistics of all the threads are summed when read
+	TByte32* survivors[numThreads];
+	std::thread threads[numThreads];
+	for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+	{
+		threads[threadIdx] = std::thread([&safeMemoryAllocator, &survivors, threadIdx]()
+		{
+			for (uint32_t iteration = 0; iteration < numIterations; ++iteration)
+			{
+				TByte4* c4 = bento::make_new<TByte4>(safeMemoryAllocator);
+				TByte16* c16 = bento::make_new<TByte16>(safeMemoryAllocator);
+				bento::make_delete<TByte4>(safeMemoryAllocator, c4);
+				bento::make_delete<TByte16>(safeMemoryAllocator, c16);
+			}
+			survivors[threadIdx] = bento::make_new<TByte32>(safeMemoryAllocator);
+		});
+	}
+	for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+		threads[threadIdx].join();
+
+	uint32_t churnedMemory = (sizeof(TByte4) + sizeof(TByte16) + headerSize * 2) * numIterations * numThreads;
+	uint32_t survivorMemory = (sizeof(TByte32) + headerSize) * numThreads;
+	assert_memory_usage(safeMemoryAllocator, survivorMemory, churnedMemory + survivorMemory, churnedMemory);
+
+	// Free the survivors from a thread that did not allocate them
+	std::thread cleaner([&safeMemoryAllocator, &survivors]()
+	{
+		for (uint32_t threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+			bento::make_delete<TByte32>(safeMemoryAllocator, survivors[threadIdx]);
+	});
+	cleaner.join();
+	assert_memory_usage(safeMemoryAllocator, 0, churnedMemory + survivorMemory, churnedMemory + survivorMemory);
+}
+
+void test_sized_deallocation()
+{
+	// An allocator that only receives sized frees doesn't need to store anything in front of the allocations
+	bento::SafeSystemAllocator sizedAllocator(bento::DeallocationMode::SIZED);
+	assert(sizedAllocator.header_size() == 0);
+	assert_memory_usage(sizedAllocator, 0, 0, 0);
+
+	// Tests that make_delete forwards the size of the structure
+	{
+		TByte4* c4 = bento::make_new<TByte4>(sizedAllocator);
+		TByte32* c32 = bento::make_new<TByte32>(sizedAllocator);
+		assert_memory_usage(sizedAllocator, sizeof(TByte4) + sizeof(TByte32), sizeof(TByte4) + sizeof(TByte32), 0);
+
+		bento::make_delete<TByte4>(sizedAllocator, c4);
+		assert_memory_usage(sizedAllocator, sizeof(TByte32), sizeof(TByte4) + sizeof(TByte32), sizeof(TByte4));
+		bento::make_delete<TByte32>(sizedAllocator, c32);
+		assert_memory_usage(sizedAllocator, 0, sizeof(TByte4) + sizeof(TByte32), sizeof(TByte4) + sizeof(TByte32));
+	}
+
+	// Tests that the vector releases its storage with its capacity
+	{
+		bento::SafeSystemAllocator vectorAllocator(bento::DeallocationMode::SIZED);
+		bento::Vector<TByte16> vc16(vectorAllocator);
+		vc16.resize(4);
+		assert_memory_usage(vectorAllocator, sizeof(TByte16) * 4, sizeof(TByte16) * 4, 0);
+		vc16.free();
+		vc16.resize(8);
+		assert_memory_usage(vectorAllocator, sizeof(TByte16) * 8, sizeof(TByte16) * 12, sizeof(TByte16) * 4);
+		vc16.free();
+		assert_memory_usage(vectorAllocator, 0, sizeof(TByte16) * 12, sizeof(TByte16) * 12);
+	}
+
+	// Tests that the explicit sized entry point of the interface is used by the default mode as well
+	{
+		bento::SafeSystemAllocator safeMemoryAllocator;
+		uint32_t headerSize = safeMemoryAllocator.header_size();
+		void* block = safeMemoryAllocator.allocate(100, 16);
+		safeMemoryAllocator.deallocate(block, 100);
+		assert_memory_usage(safeMemoryAllocator, 0, 100 + headerSize, 100 + headerSize);
+	}
+
+	// Tests that the book allocator accepts sized frees without any header
+	{
+		bento::BookAllocator bookAllocator;
+		bento::book_allocator::initialize(bookAllocator, 4, 16);
+		assert(bookAllocator.header_size() == 0);
+		void* block = bookAllocator.allocate(12, 4);
+		assert(bookAllocator.get_page_allocator(2).usage_flags() == 0x00000001);
+		bookAllocator.deallocate(block, 12);
+		assert(bookAllocator.get_page_allocator(2).usage_flags() == 0x0000000000);
+	}
+}
+
+void test_batch_allocations()
+{
+	// Tests that the page allocator claims and releases chunks in batches
+	{
+		bento::PageAllocator pageAllocator;
+		pageAllocator.initialize(16, 512);
+
+		// Leave a hole at the start so the batch has to complete the first leaf word before moving on
+		TByte16* first = bento::make_new<TByte16>(pageAllocator);
+		void* batch[200];
+		uint32_t allocated = pageAllocator.allocate_batch(200, batch);
+		assert(allocated == 200);
+		assert(pageAllocator.used_chunk_count() == 201);
+		assert(pageAllocator.leaf_usage_flags(0) == 0xFFFFFFFFFFFFFFFF);
+		assert(pageAllocator.leaf_usage_flags(1) == 0xFFFFFFFFFFFFFFFF);
+		assert(pageAllocator.leaf_usage_flags(2) == 0xFFFFFFFFFFFFFFFF);
+		assert(pageAllocator.leaf_usage_flags(3) == 0x00000000000001FF);
+
+		// Every chunk is handed out only once, the first chunk of the page is the lowest address
+		char* pageStart = (char*)first;
+		for (uint32_t chunkIdx = 0; chunkIdx < 200; ++chunkIdx)
+			pageStart = (char*)batch[chunkIdx] < pageStart ? (char*)batch[chunkIdx] : pageStart;
+		uint64_t claimedFlags[4] = { 0, 0, 0, 0 };
+		for (uint32_t chunkIdx = 0; chunkIdx <= 200; ++chunkIdx)
+		{
+			uint32_t chunkOffset = (uint32_t)(((char*)(chunkIdx < 200 ? batch[chunkIdx] : first) - pageStart) / 16);
+			assert(chunkOffset < 256);
+			uint64_t chunkBit = 1ull << (chunkOffset % 64);
+			assert((claimedFlags[chunkOffset / 64] & chunkBit) == 0);
+			claimedFlags[chunkOffset / 64] |= chunkBit;
+		}
+		for (uint32_t wordIdx = 0; wordIdx < 4; ++wordIdx)
+			assert(claimedFlags[wordIdx] == pageAllocator.leaf_usage_flags(wordIdx));
+
+		// A batch bigger than the free space is only partially served
+		void* overflow[400];
+		allocated = pageAllocator.allocate_batch(400, overflow);
+		assert(allocated == 512 - 201);
+		assert(pageAllocator.is_full());
+		pageAllocator.free_batch(overflow, allocated);
+
+		pageAllocator.free_batch(batch, 200);
+		assert(pageAllocator.used_chunk_count() == 1);
+		bento::make_delete<TByte16>(pageAllocator, first);
+		assert(pageAllocator.used_chunk_count() == 0);
+	}
+
+	// Tests the typed helpers on top of the book allocator
+	{
+		bento::BookAllocator bookAllocator;
+		bento::book_allocator::initialize(bookAllocator, 4, 16);
+		bento::PageAllocator& page2 = bookAllocator.get_page_allocator(2);
+
+		bento::SystemAllocator systemAllocator;
+		bento::Vector<TByte12*> nodes(systemAllocator);
+		uint32_t allocated = bento::make_new_batch<TByte12>(bookAllocator, 48, nodes);
+		assert(allocated == 48);
+		assert(nodes.size() == 48);
+		assert(page2.usage_flags() == 0x0000FFFFFFFFFFFF);
+		for (uint32_t nodeIdx = 0; nodeIdx < 48; ++nodeIdx)
+			nodes[nodeIdx]->data[0] = (int)nodeIdx;
+
+		bento::make_delete_batch<TByte12>(bookAllocator, nodes);
+		assert(nodes.size() == 0);
+		assert(page2.usage_flags() == 0x0000000000);
+	}
+}
+
+void test_arena_allocator()
+{
+	bento::SafeSystemAllocator parentAllocator;
+	uint32_t headerSize = parentAllocator.header_size();
+
+	// Create an arena that grows by blocks of 4k, no memory is requested until the first allocation
+	bento::ArenaAllocator arenaAllocator;
+	arenaAllocator.initialize(parentAllocator, 4096);
+	assert(arenaAllocator.block_count() == 0);
+	assert(arenaAllocator.used_memory() == 0);
+	assert_memory_usage(parentAllocator, 0, 0, 0);
+
+	// Tests that consecutive allocations are bumped inside the same block
+	{
+		TByte4* c0 = bento::make_new<TByte4>(arenaAllocator);
+		TByte4* c1 = bento::make_new<TByte4>(arenaAllocator);
+		assert(c0 != nullptr && c1 != nullptr);
+		assert(c1 == c0 + 1);
+		assert(arenaAllocator.block_count() == 1);
+		assert(arenaAllocator.used_memory() == 2 * sizeof(TByte4));
+		assert_memory_usage(parentAllocator, 4096 + headerSize, 4096 + headerSize, 0);
+
+		// Individual frees are no-ops
+		bento::make_delete<TByte4>(arenaAllocator, c0);
+		bento::make_delete<TByte4>(arenaAllocator, c1);
+		assert(arenaAllocator.used_memory() == 2 * sizeof(TByte4));
+		assert_memory_usage(parentAllocator, 4096 + headerSize, 4096 + headerSize, 0);
+	}
+
+	// Tests that the arena grows by blocks when the current one is exhausted
+	{
+		for (uint32_t chunkIdx = 0; chunkIdx < 1024; ++chunkIdx)
+		{
+			TByte16* chunk = bento::make_new<TByte16>(arenaAllocator);
+			assert(chunk != nullptr);
+		}
+		uint32_t blockCount = arenaAllocator.block_count();
+		assert(blockCount >= 4);
+		assert_memory_usage(parentAllocator, (4096 + headerSize) * blockCount, (4096 + headerSize) * blockCount, 0);
+	}
+
+	// Tests that rewinding to a marker gives the memory back to the arena
+	{
+		bento::ArenaAllocator::Marker marker = arenaAllocator.mark();
+		size_t usedMemory = arenaAllocator.used_memory();
+
+		TByte32* c0 = bento::make_new<TByte32>(arenaAllocator);
+		bento::Vector<TByte8> vc8(arenaAllocator);
+		vc8.resize(64);
+		assert(arenaAllocator.used_memory() > usedMemory);
+
+		arenaAllocator.rewind(marker);
+		assert(arenaAllocator.used_memory() == usedMemory);
+
+		// The next allocation lands where the first one after the marker was
+		TByte32* c0_bis = bento::make_new<TByte32>(arenaAllocator);
+		assert(c0_bis == c0);
+	}
+
+	// Tests that the arena can back the collections
+	{
+		bento::DynamicString* string = bento::make_new<bento::DynamicString>(arenaAllocator, arenaAllocator);
+		string->resize(1000);
+		assert(string->size() == 1000);
+		bento::make_delete<bento::DynamicString>(arenaAllocator, string);
+	}
+
+	// Tests that a reset keeps the blocks for the next round of allocations
+	{
+		uint32_t blockCount = arenaAllocator.block_count();
+		uint64_t allocatedMemory = parentAllocator.current_allocated_memory();
+		arenaAllocator.reset();
+		assert(arenaAllocator.used_memory() == 0);
+		assert(arenaAllocator.block_count() == blockCount);
+		assert(parentAllocator.current_allocated_memory() == allocatedMemory);
+
+		for (uint32_t chunkIdx = 0; chunkIdx < 1024; ++chunkIdx)
+			bento::make_new<TByte16>(arenaAllocator);
+		assert(arenaAllocator.block_count() == blockCount);
+		assert(parentAllocator.current_allocated_memory() == allocatedMemory);
+	}
+
+	// Tests that releasing the arena gives all the blocks back to the parent
+	arenaAllocator.release();
+	assert(arenaAllocator.block_count() == 0);
+	assert(parentAllocator.current_allocated_memory() == 0);
+}
+
+void test_frame_allocator()
+{
+	bento::SafeSystemAllocator parentAllocator;
+
+	// Create a double buffered frame allocator, each frame arena grows by blocks of 4k
+	bento::FrameAllocator frameAllocator;
+	frameAllocator.initialize(parentAllocator, 2, 4096);
+	assert(frameAllocator.frame_count() == 2);
+
+	// Fill the first frame
+	frameAllocator.begin_frame();
+	uint32_t firstFrame = frameAllocator.current_frame();
+	bento::Vector<TByte8> vc8(frameAllocator);
+	vc8.resize(100);
+	for (uint32_t elementIdx = 0; elementIdx < 100; ++elementIdx)
+		vc8[elementIdx].data = (double)elementIdx;
+	TByte8* firstFrameData = &vc8[0];
+	size_t firstFrameUsage = frameAllocator.frame_usage(firstFrame);
+	assert(firstFrameUsage >= sizeof(TByte8) * 100);
+
+	// The second frame uses its own arena, the data of the first frame is still alive
+	frameAllocator.begin_frame();
+	uint32_t secondFrame = frameAllocator.current_frame();
+	assert(secondFrame != firstFrame);
+	TByte32* c32 = bento::make_new<TByte32>(frameAllocator);
+	assert(c32 != nullptr);
+	assert(frameAllocator.frame_usage(secondFrame) == sizeof(TByte32));
+	for (uint32_t elementIdx = 0; elementIdx < 100; ++elementIdx)
+		assert(vc8[elementIdx].data == (double)elementIdx);
+
+	// The third frame recycles the arena of the first one wholesale
+	vc8.free();
+	frameAllocator.begin_frame();
+	assert(frameAllocator.current_frame() == firstFrame);
+	assert(frameAllocator.frame_usage(firstFrame) == 0);
+	TByte8* recycledData = bento::make_new<TByte8>(frameAllocator);
+	assert(recycledData == firstFrameData);
+
+	// The high water mark remembers the biggest frame so far
+	assert(frameAllocator.high_water_mark() == firstFrameUsage);
+
+	// Make sure all the memory is given back to the parent
+	frameAllocator.release();
+	assert(parentAllocator.current_allocated_memory() == 0);
+}
+
+void test_tlsf_allocator()
+{
+	bento::SafeSystemAllocator parentAllocator;
+
+	// Create a tlsf allocator over a 1MB region requested from the parent
+	bento::TlsfAllocator tlsfAllocator;
+	tlsfAllocator.initialize(parentAllocator, 1024 * 1024);
+	size_t initialFreeBlock = tlsfAllocator.largest_free_block();
+	assert(initialFreeBlock > 0);
+
+	// Tests that blocks of various sizes can be allocated and freed
+	{
+		TByte4* c4 = bento::make_new<TByte4>(tlsfAllocator);
+		TByte32* c32 = bento::make_new<TByte32>(tlsfAllocator);
+		bento::Vector<TByte16> vc16(tlsfAllocator);
+		vc16.resize(1000);
+		assert(c4 != nullptr && c32 != nullptr);
+		assert(tlsfAllocator.largest_free_block() < initialFreeBlock);
+
+		vc16.free();
+		bento::make_delete<TByte32>(tlsfAllocator, c32);
+		bento::make_delete<TByte4>(tlsfAllocator, c4);
+		assert(tlsfAllocator.largest_free_block() == initialFreeBlock);
+	}
+
+	// Tests that neighbouring free blocks are coalesced
+	{
+		void* b0 = tlsfAllocator.allocate(256, 16);
+		void* b1 = tlsfAllocator.allocate(256, 16);
+		void* b2 = tlsfAllocator.allocate(256, 16);
+		assert(b0 != nullptr && b1 != nullptr && b2 != nullptr);
+
+		// Once merged, the two first blocks can hold an allocation that neither of them could
+		tlsfAllocator.deallocate(b1);
+		tlsfAllocator.deallocate(b0);
+		void* merged = tlsfAllocator.allocate(384, 16);
+		assert(merged == b0);
+
+		tlsfAllocator.deallocate(merged);
+		tlsfAllocator.deallocate(b2);
+		assert(tlsfAllocator.largest_free_block() == initialFreeBlock);
+	}
+
+	// Tests that an allocation bigger than the region fails
+	{
+		void* tooMuch = tlsfAllocator.allocate(2 * 1024 * 1024, 16);
+		assert(tooMuch == nullptr);
+	}
+
+	// Tests that the allocator can also manage a caller provided region
+	{
+		static char region[64 * 1024];
+		bento::TlsfAllocator regionAllocator;
+		regionAllocator.initialize(region, sizeof(region));
+		TByte16* c16 = bento::make_new<TByte16>(regionAllocator);
+		assert((char*)c16 >= region && (char*)c16 < region + sizeof(region));
+		bento::make_delete<TByte16>(regionAllocator, c16);
+	}
+
+	// Make sure the region is given back to the parent
+	tlsfAllocator.release();
+	assert(parentAllocator.current_allocated_memory() == 0);
+}
+
+void test_virtual_memory_allocator()
+{
+	// Reserve 4GB of address space, nothing is committed yet
+	bento::VirtualMemoryAllocator vmAllocator;
+	vmAllocator.initialize(4ull * 1024 * 1024 * 1024);
+	assert(vmAllocator.reserved_memory() == 4ull * 1024 * 1024 * 1024);
+	assert(vmAllocator.committed_memory() == 0);
+
+	// Tests that the last block of the reservation grows in place
+	{
+		void* block = vmAllocator.allocate(1024, 16);
+		assert(block != nullptr);
+		assert(vmAllocator.committed_memory() >= 1024);
+		bool grown = vmAllocator.try_grow(block, 1024, 64 * 1024 * 1024);
+		assert(grown);
+		assert(vmAllocator.committed_memory() >= 64 * 1024 * 1024);
+		vmAllocator.deallocate(block);
+	}
+
+	// Tests that a vector extends without copying when its allocator can grow in place
+	{
+		bento::Vector<uint32_t> values(vmAllocator);
+		values.resize(1000);
+		for (uint32_t valueIdx = 0; valueIdx < 1000; ++valueIdx)
+			values[valueIdx] = valueIdx;
+		uint32_t* data = &values[0];
+
+		values.resize(16 * 1024 * 1024);
+		assert(&values[0] == data);
+		for (uint32_t valueIdx = 0; valueIdx < 1000; ++valueIdx)
+			assert(values[valueIdx] == valueIdx);
+
+		// Once another block follows it, the vector has to move
+		void* blocker = vmAllocator.allocate(16, 16);
+		values.resize(32 * 1024 * 1024);
+		assert(&values[0] != data);
+		for (uint32_t valueIdx = 0; valueIdx < 1000; ++valueIdx)
+			assert(values[valueIdx] == valueIdx);
+		vmAllocator.deallocate(blocker);
+	}
+
+	// Allocators that can't grow in place keep the allocate, copy and free path
+	{
+		bento::SafeSystemAllocator safeMemoryAllocator;
+		uint32_t headerSize = safeMemoryAllocator.header_size();
+		void* block = safeMemoryAllocator.allocate(1024, 16);
+		bool grown = safeMemoryAllocator.try_grow(block, 1024, 2048);
+		assert(!grown);
+		assert_memory_usage(safeMemoryAllocator, 1024 + headerSize, 1024 + headerSize, 0);
+		safeMemoryAllocator.deallocate(block);
+		assert_memory_usage(safeMemoryAllocator, 0, 1024 + headerSize, 1024 + headerSize);
+	}
+
+	// Make sure all the pages are decommitted
+	vmAllocator.release();
+	assert(vmAllocator.committed_memory() == 0);
+}
+
+void profiled_allocations_site_a(bento::IAllocator& allocator, TByte16** c16, uint32_t count)
+{
+	for (uint32_t chunkIdx = 0; chunkIdx < count; ++chunkIdx)
+		c16[chunkIdx] = bento::make_new<TByte16>(allocator);
+}
+
+void profiled_allocations_site_b(bento::IAllocator& allocator, TByte32** c32, uint32_t count)
+{
+	for (uint32_t chunkIdx = 0; chunkIdx < count; ++chunkIdx)
+		c32[chunkIdx] = bento::make_new<TByte32>(allocator);
+}
+
+void test_heap_profiler()
+{
+	bento::SafeSystemAllocator parentAllocator;
+	bento::SystemAllocator profileAllocator;
+
+	// Tests that every allocation is recorded with its call site when sampling every byte
+	{
+		bento::HeapProfiler heapProfiler;
+		heapProfiler.initialize(parentAllocator, profileAllocator, 1);
+
+		TByte16* c16[16];
+		TByte32* c32[16];
+		profiled_allocations_site_a(heapProfiler, c16, 16);
+		profiled_allocations_site_b(heapProfiler, c32, 16);
+		assert(heapProfiler.live_bytes() == (sizeof(TByte16) + sizeof(TByte32)) * 16);
+		assert(heapProfiler.cumulative_bytes() == (sizeof(TByte16) + sizeof(TByte32)) * 16);
+
+		// Sites are indexed in the order they were first recorded
+		assert(heapProfiler.site_count() == 2);
+		assert(heapProfiler.site_live_bytes(0) == sizeof(TByte16) * 16);
+		assert(heapProfiler.site_live_bytes(1) == sizeof(TByte32) * 16);
+		assert(heapProfiler.site_cumulative_bytes(0) == sizeof(TByte16) * 16);
+		assert(heapProfiler.site_cumulative_bytes(1) == sizeof(TByte32) * 16);
+
+		// Frees only affect the live totals
+		for (uint32_t chunkIdx = 0; chunkIdx < 16; ++chunkIdx)
+		{
+			bento::make_delete<TByte16>(heapProfiler, c16[chunkIdx]);
+			bento::make_delete<TByte32>(heapProfiler, c32[chunkIdx]);
+		}
+		assert(heapProfiler.live_bytes() == 0);
+		assert(heapProfiler.cumulative_bytes() == (sizeof(TByte16) + sizeof(TByte32)) * 16);
+		assert(heapProfiler.site_live_bytes(0) == 0);
+		assert(heapProfiler.site_live_bytes(1) == 0);
+		assert(heapProfiler.site_cumulative_bytes(0) == sizeof(TByte16) * 16);
+		assert(heapProfiler.site_cumulative_bytes(1) == sizeof(TByte32) * 16);
+
+		// The folded stack profile has one line per call site, ending with its byte count
+		bento::DynamicString profile(profileAllocator);
+		heapProfiler.write_folded_stacks(profile, bento::HeapProfileType::CUMULATIVE);
+		assert(profile.size() > 0);
+		assert(profile.c_str()[profile.size() - 1] == '\n');
+
+		uint32_t numLines = 0;
+		bool siteFound[2] = { false, false };
+		const char* line = profile.c_str();
+		while (*line != '\0')
+		{
+			const char* lineEnd = strchr(line, '\n');
+			assert(lineEnd != nullptr);
+
+			// The count is separated from the stack by the last space of the line
+			const char* count = lineEnd;
+			while (count > line && count[-1] != ' ')
+				--count;
+			assert(count > line && count < lineEnd);
+			unsigned long long siteBytes = strtoull(count, nullptr, 10);
+			for (uint32_t siteIdx = 0; siteIdx < 2; ++siteIdx)
+			{
+				if (siteBytes == heapProfiler.site_cumulative_bytes(siteIdx))
+					siteFound[siteIdx] = true;
+			}
+
+			++numLines;
+			line = lineEnd + 1;
+		}
+		assert(numLines == heapProfiler.site_count());
+		assert(siteFound[0] && siteFound[1]);
+
+		heapProfiler.release();
+	}
+
+	// Tests that Poisson sampling gives an unbiased estimate of the allocated bytes
+	{
+		bento::HeapProfiler heapProfiler;
+		heapProfiler.initialize(parentAllocator, profileAllocator, 64 * 1024);
+
+		const uint32_t numAllocations = 100000;
+		for (uint32_t allocationIdx = 0; allocationIdx < numAllocations; ++allocationIdx)
+		{
+			TByte32* c32 = bento::make_new<TByte32>(heapProfiler);
+			bento::make_delete<TByte32>(heapProfiler, c32);
+		}
+
+		// Around 50 samples are taken, the estimate stays well within a factor of two
+		uint64_t allocatedBytes = (uint64_t)sizeof(TByte32) * numAllocations;
+		uint64_t estimatedBytes = heapProfiler.cumulative_bytes();
+		assert(estimatedBytes > allocatedBytes / 2 && estimatedBytes < allocatedBytes * 2);
+		assert(heapProfiler.live_bytes() == 0);
+
+		heapProfiler.release();
+	}
+
+	// The profiler doesn't keep any memory of the profiled allocator
+	assert(parentAllocator.current_allocated_memory() == 0);
+}
+
+void test_trace_allocator()
+{
+	bento::SafeSystemAllocator parentAllocator;
+	const char* tracePath = "allocator_tester_trace.bin";
+
+	// Record a few allocations and frees, the wrapped allocator does the actual work
+	{
+		bento::TraceAllocator traceAllocator;
+		traceAllocator.initialize(parentAllocator, tracePath);
+
+		TByte4* c4 = bento::make_new<TByte4>(traceAllocator);
+		TByte32* c32 = bento::make_new<TByte32>(traceAllocator);
+		assert(parentAllocator.current_allocated_memory() > 0);
+		bento::make_delete<TByte4>(traceAllocator, c4);
+		bento::make_delete<TByte32>(traceAllocator, c32);
+		assert(traceAllocator.event_count() == 4);
+
+		traceAllocator.close();
+		assert(parentAllocator.current_allocated_memory() == 0);
+	}
+
+	// Read the trace back and check the recorded events
+	{
+		bento::SystemAllocator systemAllocator;
+		bento::Vector<bento::AllocationEvent> events(systemAllocator);
+		bool loaded = bento::allocation_trace::load(tracePath, events);
+		assert(loaded);
+		assert(events.size() == 4);
+
+		assert(events[0].type == bento::AllocationEventType::ALLOCATE);
+		assert(events[0].size == sizeof(TByte4));
+		assert(events[0].alignment == alignof(TByte4));
+		assert(events[1].type == bento::AllocationEventType::ALLOCATE);
+		assert(events[1].size == sizeof(TByte32));
+		assert(events[1].pointer_id != events[0].pointer_id);
+
+		// Frees refer to the anonymized identifier of the allocation they release
+		assert(events[2].type == bento::AllocationEventType::FREE);
+		assert(events[2].pointer_id == events[0].pointer_id);
+		assert(events[3].type == bento::AllocationEventType::FREE);
+		assert(events[3].pointer_id == events[1].pointer_id);
+
+		// Events are ordered in time and were all recorded from this thread
+		for (uint32_t eventIdx = 1; eventIdx < events.size(); ++eventIdx)
+		{
+			assert(events[eventIdx].timestamp >= events[eventIdx - 1].timestamp);
+			assert(events[eventIdx].thread_id == events[0].thread_id);
+		}
+	}
+	remove(tracePath);
+}
+
+void test_aligned_allocations()
+{
+	// Tests that over-aligned types are honoured by the system allocators
+	{
+		bento::SystemAllocator systemAllocator;
+		bento::SafeSystemAllocator safeMemoryAllocator;
+		TSimd32* simd[8];
+		TCacheLine64* counters[8];
+		for (uint32_t allocationIdx = 0; allocationIdx < 8; ++allocationIdx)
+		{
+			simd[allocationIdx] = bento::make_new<TSimd32>(systemAllocator);
+			counters[allocationIdx] = bento::make_new<TCacheLine64>(safeMemoryAllocator);
+			assert(is_aligned(simd[allocationIdx], 32));
+			assert(is_aligned(counters[allocationIdx], 64));
+		}
+		for (uint32_t allocationIdx = 0; allocationIdx < 8; ++allocationIdx)
+		{
+			bento::make_delete<TSimd32>(systemAllocator, simd[allocationIdx]);
+			bento::make_delete<TCacheLine64>(safeMemoryAllocator, counters[allocationIdx]);
+		}
+		assert(safeMemoryAllocator.current_allocated_memory() == 0);
+
+		// Explicit alignments go through the same path
+		void* buffer = safeMemoryAllocator.allocate(1000, 128);
+		assert(is_aligned(buffer, 128));
+		safeMemoryAllocator.deallocate(buffer);
+		assert(safeMemoryAllocator.current_allocated_memory() == 0);
+	}
+
+	// Tests that the vector storage follows the alignment of its elements
+	{
+		bento::SafeSystemAllocator safeMemoryAllocator;
+		bento::Vector<TCacheLine64> counters(safeMemoryAllocator);
+		for (uint32_t size = 1; size < 100; size += 7)
+		{
+			counters.resize(size);
+			assert(is_aligned(&counters[0], 64));
+		}
+		bento::Vector<float> values(safeMemoryAllocator, 0, 32);
+		values.resize(17);
+		assert(is_aligned(&values[0], 32));
+	}
+
+	// Tests that the page allocator aligns its chunks when asked to
+	{
+		bento::PageAllocator pageAllocator;
+		pageAllocator.initialize(64, 64, 64);
+		TCacheLine64* counters[64];
+		for (uint32_t chunkIdx = 0; chunkIdx < 64; ++chunkIdx)
+		{
+			counters[chunkIdx] = bento::make_new<TCacheLine64>(pageAllocator);
+			assert(is_aligned(counters[chunkIdx], 64));
+		}
+		for (uint32_t chunkIdx = 0; chunkIdx < 64; ++chunkIdx)
+			bento::make_delete<TCacheLine64>(pageAllocator, counters[chunkIdx]);
+		assert(pageAllocator.usage_flags() == 0x0000000000);
+
+		// A request more aligned than the chunks can't be served
+		bento::PageAllocator smallPageAllocator;
+		smallPageAllocator.initialize(16);
+		void* misaligned = smallPageAllocator.allocate(16, 64);
+		assert(misaligned == nullptr);
+	}
+
+	// Tests that the book allocator routes aligned requests to a size class that can honour them
+	{
+		bento::BookAllocator bookAllocator;
+		bento::book_allocator::initialize(bookAllocator, 4, 64);
+		bento::PageAllocator& page1 = bookAllocator.get_page_allocator(1);
+		bento::PageAllocator& page3 = bookAllocator.get_page_allocator(3);
+
+		TSimd32* simd = bento::make_new<TSimd32>(bookAllocator);
+		assert(is_aligned(simd, 32));
+		assert(page1.usage_flags() == 0x00000001);
+
+		TCacheLine64* counter = bento::make_new<TCacheLine64>(bookAllocator);
+		assert(is_aligned(counter, 64));
+		assert(page3.usage_flags() == 0x00000001);
+
+		// A small request with a big alignment is bumped to the first size class that is aligned enough
+		void* smallAligned = bookAllocator.allocate(16, 64);
+		assert(is_aligned(smallAligned, 64));
+		assert(page3.usage_flags() == 0x00000003);
+		bookAllocator.deallocate(smallAligned);
+
+		bento::make_delete<TCacheLine64>(bookAllocator, counter);
+		bento::make_delete<TSimd32>(bookAllocator, simd);
+		assert(page1.usage_flags() == 0x0000000000);
+		assert(page3.usage_flags() == 0x0000000000);
+	}
+}
+
+void test_allocator_stats()
+{
+	bento::SystemAllocator systemAllocator;
+
+	// Tests the statistics of the book allocator
+	{
+		bento::BookAllocator bookAllocator;
+		bento::book_allocator::initialize(bookAllocator, 4, 16);
+
+		void* c5 = bookAllocator.allocate(5, 1);
+		TByte12* c12_0 = bento::make_new<TByte12>(bookAllocator);
+		TByte12* c12_1 = bento::make_new<TByte12>(bookAllocator);
+		TByte16* c16 = bento::make_new<TByte16>(bookAllocator);
+
+		bento::AllocatorStats stats(systemAllocator);
+		bool collected = bookAllocator.collect_stats(stats);
+		assert(collected);
+		assert(stats.allocation_count == 4);
+		assert(stats.free_count == 0);
+		assert(stats.live_requested_bytes == 5 + 12 + 12 + 16);
+		assert(stats.live_bytes == 8 + 12 + 12 + 16);
+		assert(stats.peak_live_bytes == stats.live_bytes);
+
+		// The 5 bytes request is served by the 8 bytes size class
+		assert(stats.live_bytes - stats.live_requested_bytes == 3);
+
+		// Power of two size buckets
+		assert(stats.size_histogram[2] == 1);
+		assert(stats.size_histogram[3] == 2);
+		assert(stats.size_histogram[4] == 1);
+
+		// Per size class occupancy
+		assert(stats.size_classes.size() == 4);
+		assert(stats.size_classes[0].chunk_size == 4 && stats.size_classes[0].used_chunks == 0);
+		assert(stats.size_classes[1].chunk_size == 8 && stats.size_classes[1].used_chunks == 1);
+		assert(stats.size_classes[2].chunk_size == 12 && stats.size_classes[2].used_chunks == 2);
+		assert(stats.size_classes[3].chunk_size == 16 && stats.size_classes[3].used_chunks == 1);
+		assert(stats.size_classes[2].total_chunks == 64);
+
+		// The peak survives the frees
+		uint64_t peakLiveBytes = stats.peak_live_bytes;
+		bento::make_delete<TByte16>(bookAllocator, c16);
+		bento::make_delete<TByte12>(bookAllocator, c12_1);
+		bento::make_delete<TByte12>(bookAllocator, c12_0);
+		bookAllocator.deallocate(c5);
+		collected = bookAllocator.collect_stats(stats);
+		assert(collected);
+		assert(stats.free_count == 4);
+		assert(stats.live_bytes == 0);
+		assert(stats.live_requested_bytes == 0);
+		assert(stats.peak_live_bytes == peakLiveBytes);
+
+		// The snapshot can be exported as json
+		bento::DynamicString json(systemAllocator);
+		bento::allocator_stats::write_json(stats, json);
+		assert(json.size() > 0);
+		assert(json.c_str()[0] == '{');
+		assert(strstr(json.c_str(), "\"peak_live_bytes\":") != nullptr);
+		assert(strstr(json.c_str(), "\"size_classes\":[") != nullptr);
+
+		// The emitter logs a snapshot every time its period is elapsed
+		bento::AllocatorStatsEmitter emitter;
+		emitter.initialize(bookAllocator, "book", 0, systemAllocator);
+		bool emitted = emitter.update();
+		assert(emitted);
+
+		// The rates are evaluated over the interval since the previous snapshot
+		TByte4* c4[8];
+		for (uint32_t chunkIdx = 0; chunkIdx < 8; ++chunkIdx)
+			c4[chunkIdx] = bento::make_new<TByte4>(bookAllocator);
+		for (uint32_t chunkIdx = 0; chunkIdx < 4; ++chunkIdx)
+			bento::make_delete<TByte4>(bookAllocator, c4[chunkIdx]);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		emitted = emitter.update();
+		assert(emitted);
+		assert(emitter.allocation_rate() > 0.0);
+		assert(emitter.free_rate() > 0.0);
+		assert(emitter.allocation_rate() == 2.0 * emitter.free_rate());
+
+		for (uint32_t chunkIdx = 4; chunkIdx < 8; ++chunkIdx)
+			bento::make_delete<TByte4>(bookAllocator, c4[chunkIdx]);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		emitted = emitter.update();
+		assert(emitted);
+		assert(emitter.allocation_rate() == 0.0);
+		assert(emitter.free_rate() > 0.0);
+	}
+
+	// Tests the statistics of the safe system allocator, which has no size classes
+	{
+		bento::SafeSystemAllocator safeMemoryAllocator;
+		TByte32* c32 = bento::make_new<TByte32>(safeMemoryAllocator);
+		bento::make_delete<TByte32>(safeMemoryAllocator, c32);
+
+		bento::AllocatorStats stats(systemAllocator);
+		bool collected = safeMemoryAllocator.collect_stats(stats);
+		assert(collected);
+		assert(stats.allocation_count == 1);
+		assert(stats.free_count == 1);
+		assert(stats.live_bytes == 0);
+		assert(stats.peak_live_bytes == sizeof(TByte32) + safeMemoryAllocator.header_size());
+		assert(stats.size_histogram[5] == 1);
+		assert(stats.size_classes.size() == 0);
+	}
+
+	// Allocators that don't track anything say so
+	{
+		bento::AllocatorStats stats(systemAllocator);
+		bool collected = systemAllocator.collect_stats(stats);
+		assert(!collected);
+	}
+}
+
+void test_concurrent_book_allocator()
+{
+	bento::SafeSystemAllocator backingAllocator;
+
+	// Create a book sharded across 4 arenas, pages are pulled from the backing allocator
+	bento::ConcurrentBookAllocator bookAllocator;
+	bento::concurrent_book_allocator::initialize(bookAllocator, 4, 16, 4, backingAllocator);
+	assert(bookAllocator.arena_count() == 4);
+	assert(bookAllocator.live_chunk_count() == 0);
+
+	// Tests that a single thread uses the book like a regular one
+	{
+		TByte4* c4 = bento::make_new<TByte4>(bookAllocator);
+		TByte16* c16 = bento::make_new<TByte16>(bookAllocator);
+		assert(c4 != nullptr && c16 != nullptr);
+		assert(bookAllocator.live_chunk_count() == 2);
+
+		// Frees from the owning thread don't go through the remote queue
+		bento::make_delete<TByte16>(bookAllocator, c16);
+		bento::make_delete<TByte4>(bookAllocator, c4);
+		assert(bookAllocator.pending_remote_frees() == 0);
+		assert(bookAllocator.live_chunk_count() == 0);
+	}
+
+	// Tests that messages allocated by one thread can be freed by another one
+	{
+		const uint32_t numMessages = 1000;
+		TByte12* messages[numMessages];
+		for (uint32_t messageIdx = 0; messageIdx < numMessages; ++messageIdx)
+		{
+			messages[messageIdx] = bento::make_new<TByte12>(bookAllocator);
+			assert(messages[messageIdx] != nullptr);
+			messages[messageIdx]->data[0] = (int)messageIdx;
+		}
+
+		std::thread consumer([&bookAllocator, &messages]()
+		{
+			for (uint32_t messageIdx = 0; messageIdx < numMessages; ++messageIdx)
+			{
+				assert(messages[messageIdx]->data[0] == (int)messageIdx);
+				bento::make_delete<TByte12>(bookAllocator, messages[messageIdx]);
+			}
+		});
+		consumer.join();
+
+		// The chunks wait in the remote free queue of the owner until it drains it
+		assert(bookAllocator.pending_remote_frees() == numMessages);
+		bookAllocator.drain_remote_frees();
+		assert(bookAllocator.pending_remote_frees() == 0);
+		assert(bookAllocator.live_chunk_count() == 0);
+	}
+
+	// Producers and consumers run concurrently, the owners drain their queues while allocating
+	{
+		const uint32_t numPairs = 4;
+		const uint32_t numMessages = 20000;
+		const uint32_t queueCapacity = 256;
+
+		struct MessageQueue
+		{
+			TByte8* slots[queueCapacity];
+			std::atomic<uint32_t> head;
+			std::atomic<uint32_t> tail;
+		};
+		MessageQueue queues[numPairs];
+		std::thread threads[numPairs * 2];
+		for (uint32_t pairIdx = 0; pairIdx < numPairs; ++pairIdx)
+		{
+			MessageQueue& queue = queues[pairIdx];
+			queue.head.store(0);
+			queue.tail.store(0);
+
+			// Producer
+			threads[pairIdx * 2] = std::thread([&bookAllocator, &queue]()
+			{
+				for (uint32_t messageIdx = 0; messageIdx < numMessages; ++messageIdx)
+				{
+					TByte8* message = bento::make_new<TByte8>(bookAllocator);
+					assert(message != nullptr);
+					message->data = (double)messageIdx;
+					uint32_t head = queue.head.load();
+					while (head - queue.tail.load() == queueCapacity)
+						std::this_thread::yield();
+					queue.slots[head % queueCapacity] = message;
+					queue.head.store(head + 1);
+				}
+				bookAllocator.drain_remote_frees();
+			});
+
+			// Consumer
+			threads[pairIdx * 2 + 1] = std::thread([&bookAllocator, &queue]()
+			{
+				for (uint32_t messageIdx = 0; messageIdx < numMessages; ++messageIdx)
+				{
+					uint32_t tail = queue.tail.load();
+					while (queue.head.load() == tail)
+						std::this_thread::yield();
+					TByte8* message = queue.slots[tail % queueCapacity];
+					queue.tail.store(tail + 1);
+					assert(message->data == (double)messageIdx);
+					bento::make_delete<TByte8>(bookAllocator, message);
+				}
+			});
+		}
+		for (uint32_t threadIdx = 0; threadIdx < numPairs * 2; ++threadIdx)
+			threads[threadIdx].join();
+
+		// Whatever was freed after the last drain of a producer is still queued
+		bookAllocator.drain_all_remote_frees();
+		assert(bookAllocator.pending_remote_frees() == 0);
+		assert(bookAllocator.live_chunk_count() == 0);
+	}
+
+	// Make sure all the pages are given back
+	bookAllocator.release();
+	assert(backingAllocator.current_allocated_memory() == 0);
+}
+
+void test_allocator_trimming()
+{
+	bento::SafeSystemAllocator backingAllocator;
+
+	// Create a book that keeps up to 8 empty pages per size class and let it cache 3 of them
+	bento::BookAllocator bookAllocator;
+	bento::book_allocator::initialize(bookAllocator, 4, 16, backingAllocator, 8);
+	uint64_t initialMemory = backingAllocator.current_allocated_memory();
+	{
+		TByte4* c[256];
+		for (uint32_t chunkIdx = 0; chunkIdx < 256; ++chunkIdx)
+			c[chunkIdx] = bento::make_new<TByte4>(bookAllocator);
+		for (uint32_t chunkIdx = 0; chunkIdx < 256; ++chunkIdx)
+			bento::make_delete<TByte4>(bookAllocator, c[chunkIdx]);
+		assert(bookAllocator.page_count(0) == 4);
+	}
+
+	// Tests that a trim with a target keeps that much cached capacity
+	{
+		uint64_t cachedMemory = backingAllocator.current_allocated_memory() - initialMemory;
+		size_t releasedMemory = bookAllocator.trim(cachedMemory / 2);
+		assert(releasedMemory > 0);
+		assert(backingAllocator.current_allocated_memory() - initialMemory <= cachedMemory / 2);
+		assert(bookAllocator.page_count(0) > 1);
+
+		// A zero target gives back every empty page that isn't part of the initial layout
+		bookAllocator.trim(0);
+		assert(bookAllocator.page_count(0) == 1);
+		assert(backingAllocator.current_allocated_memory() == initialMemory);
+	}
+
+	// Tests that an arena gives its idle blocks back
+	bento::ArenaAllocator arenaAllocator;
+	arenaAllocator.initialize(backingAllocator, 4096);
+	{
+		for (uint32_t chunkIdx = 0; chunkIdx < 1024; ++chunkIdx)
+			bento::make_new<TByte16>(arenaAllocator);
+		arenaAllocator.reset();
+		assert(arenaAllocator.block_count() > 0);
+		size_t releasedMemory = arenaAllocator.trim(0);
+		assert(releasedMemory > 0);
+		assert(arenaAllocator.block_count() == 0);
+		assert(backingAllocator.current_allocated_memory() == initialMemory);
+	}
+
+	// Allocators without cached capacity have nothing to release
+	{
+		bento::SystemAllocator systemAllocator;
+		size_t releasedMemory = systemAllocator.trim(0);
+		assert(releasedMemory == 0);
+	}
+
+	// Tests that the registry trims every registered allocator at once
+	{
+		bento::AllocatorRegistry registry;
+		registry.register_allocator(bookAllocator);
+		registry.register_allocator(arenaAllocator);
+
+		// Fill both allocators again
+		TByte4* c[128];
+		for (uint32_t chunkIdx = 0; chunkIdx < 128; ++chunkIdx)
+			c[chunkIdx] = bento::make_new<TByte4>(bookAllocator);
+		for (uint32_t chunkIdx = 0; chunkIdx < 128; ++chunkIdx)
+			bento::make_delete<TByte4>(bookAllocator, c[chunkIdx]);
+		for (uint32_t chunkIdx = 0; chunkIdx < 1024; ++chunkIdx)
+			bento::make_new<TByte16>(arenaAllocator);
+		arenaAllocator.reset();
+
+		size_t releasedMemory = registry.trim_all(0);
+		assert(releasedMemory > 0);
+		assert(backingAllocator.current_allocated_memory() == initialMemory);
+
+		// Unregistered allocators are left alone
+		registry.unregister_allocator(arenaAllocator);
+		for (uint32_t chunkIdx = 0; chunkIdx < 1024; ++chunkIdx)
+			bento::make_new<TByte16>(arenaAllocator);
+		arenaAllocator.reset();
+		registry.trim_all(0);
+		assert(arenaAllocator.block_count() > 0);
+		arenaAllocator.release();
+
+#if defined(LINUXPC)
+		// The signal handler only raises a flag, the trim happens on the next poll from a regular thread
+		bento::ArenaAllocator signalArena;
+		signalArena.initialize(backingAllocator, 4096);
+		registry.register_allocator(signalArena);
+		registry.install_signal_handler(SIGUSR1);
+		for (uint32_t chunkIdx = 0; chunkIdx < 1024; ++chunkIdx)
+			bento::make_new<TByte16>(signalArena);
+		signalArena.reset();
+		raise(SIGUSR1);
+		assert(signalArena.block_count() > 0);
+		releasedMemory = registry.poll();
+		assert(releasedMemory > 0);
+		assert(signalArena.block_count() == 0);
+		registry.uninstall_signal_handler();
+		registry.unregister_allocator(signalArena);
+		signalArena.release();
+#endif
+		registry.unregister_allocator(bookAllocator);
+	}
+
+	// Make sure the book gives its initial pages back too
+	bookAllocator.release();
+	assert(backingAllocator.current_allocated_memory() == 0);
+}
+
+void test_std_allocator()
+{
+	// Tests that standard containers draw their memory from a bento allocator
+	{
+		bento::SafeSystemAllocator safeMemoryAllocator;
+		uint32_t headerSize = safeMemoryAllocator.header_size();
+		{
+			// Resizing an empty vector allocates exactly the requested elements
+			bento::StdAllocator<TByte16> allocator(safeMemoryAllocator);
+			std::vector<TByte16, bento::StdAllocator<TByte16> > values(allocator);
+			values.resize(100);
+			assert_memory_usage(safeMemoryAllocator, sizeof(TByte16) * 100 + headerSize, sizeof(TByte16) * 100 + headerSize, 0);
+		}
+		assert(safeMemoryAllocator.current_allocated_memory() == 0);
+		assert(safeMemoryAllocator.total_freed_memory() == safeMemoryAllocator.total_memory_allocated());
+	}
+
+	// Tests that node based containers rebind the allocator to their internal nodes
+	{
+		bento::SafeSystemAllocator safeMemoryAllocator;
+		{
+			typedef std::pair<const uint32_t, TByte8> MapEntry;
+			bento::StdAllocator<MapEntry> allocator(safeMemoryAllocator);
+			std::unordered_map<uint32_t, TByte8, std::hash<uint32_t>, std::equal_to<uint32_t>, bento::StdAllocator<MapEntry> > entries(16, std::hash<uint32_t>(), std::equal_to<uint32_t>(), allocator);
+			for (uint32_t entryIdx = 0; entryIdx < 100; ++entryIdx)
+				entries[entryIdx].data = (double)entryIdx;
+			assert(entries.size() == 100);
+			assert(safeMemoryAllocator.current_allocated_memory() >= sizeof(MapEntry) * 100);
+		}
+		assert(safeMemoryAllocator.current_allocated_memory() == 0);
+	}
+
+	// Tests that strings can live in a book allocator
+	{
+		bento::BookAllocator bookAllocator;
+		bento::book_allocator::initialize(bookAllocator, 4, 64);
+		{
+			typedef std::basic_string<char, std::char_traits<char>, bento::StdAllocator<char> > BookString;
+			BookString string("a string too long for the small string optimization", bento::StdAllocator<char>(bookAllocator));
+			assert(string.size() == 51);
+			assert(bookAllocator.get_page_allocator(3).usage_flags() == 0x00000001);
+		}
+		assert(bookAllocator.get_page_allocator(3).usage_flags() == 0x0000000000);
+	}
+
+	// Allocators compare equal when they wrap the same bento allocator
+	{
+		bento::SystemAllocator systemAllocator0;
+		bento::SystemAllocator systemAllocator1;
+		bento::StdAllocator<int> allocator0(systemAllocator0);
+		bento::StdAllocator<double> rebound(allocator0);
+		assert(bento::StdAllocator<int>(rebound) == allocator0);
+		assert(bento::StdAllocator<int>(systemAllocator1) != allocator0);
+	}
+
+	// Tests that polymorphic containers can draw from a bento allocator through a memory resource
+	{
+		bento::SafeSystemAllocator safeMemoryAllocator;
+		{
+			bento::MemoryResource memoryResource(safeMemoryAllocator);
+			std::pmr::vector<uint32_t> values(&memoryResource);
+			values.resize(1000);
+			assert(safeMemoryAllocator.current_allocated_memory() >= sizeof(uint32_t) * 1000);
+		}
+		assert(safeMemoryAllocator.current_allocated_memory() == 0);
+	}
+}
+
+void test_safe_system_allocator()
+{
+	{
+		bento::SafeSystemAllocator safeMemoryAllocator;
+		assert_memory_usage(safeMemoryAllocator, 0, 0, 0);
+		uint32_t headerSize = safeMemoryAllocator.header_size();
+
+		TByte4* c4 = bento::make_new<TByte4>(safeMemoryAllocator);
+		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) + headerSize), (sizeof(TByte4) + headerSize), 0);
+
+		TByte8* c8 = bento::make_new<TByte8>(safeMemoryAllocator);
+		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) + sizeof(TByte8) + headerSize * 2), (sizeof(TByte4) + sizeof(TByte8) + headerSize * 2), 0);
+
+		TByte32* c32 = bento::make_new<TByte32>(safeMemoryAllocator);
+		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3), (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3), 0);
+
+		bento::make_delete<TByte4>(safeMemoryAllocator, c4);
+		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte8) + sizeof(TByte32) + headerSize * 2), (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3), sizeof(TByte4) + headerSize);
+
+		bento::make_delete<TByte8>(safeMemoryAllocator, c8);
+		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte32) + headerSize), (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3), (sizeof(TByte4) + sizeof(TByte8) + headerSize * 2));
+
+		bento::make_delete<TByte32>(safeMemoryAllocator, c32);
+		assert_memory_usage(safeMemoryAllocator, 0, (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3), (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3));
+	}
+
+	{
+		bento::SafeSystemAllocator safeMemoryAllocator;
+		assert_memory_usage(safeMemoryAllocator, 0, 0, 0);
+		uint32_t headerSize = safeMemoryAllocator.header_size();
+
+		TByte4* c4 = bento::make_new<TByte4>(safeMemoryAllocator);
+		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) + headerSize), (sizeof(TByte4) + headerSize), 0);
+
+		bento::make_delete<TByte4>(safeMemoryAllocator, c4);
+		assert_memory_usage(safeMemoryAllocator, 0, (sizeof(TByte4) + headerSize), (sizeof(TByte4) + headerSize));
+
+		TByte8* c8 = bento::make_new<TByte8>(safeMemoryAllocator);
+		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte8) + headerSize), (sizeof(TByte4) + sizeof(TByte8) + headerSize * 2), (sizeof(TByte4) + headerSize));
+
+		bento::make_delete<TByte8>(safeMemoryAllocator, c8);
+		assert_memory_usage(safeMemoryAllocator, 0, (sizeof(TByte4) + sizeof(TByte8) + headerSize * 2), (sizeof(TByte4) + sizeof(TByte8) + headerSize * 2));
+
+		TByte32* c32 = bento::make_new<TByte32>(safeMemoryAllocator);
+		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte32) + headerSize), (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3), (sizeof(TByte4) + sizeof(TByte8) + headerSize * 2));
+
+		bento::make_delete<TByte32>(safeMemoryAllocator, c32);
+		assert_memory_usage(safeMemoryAllocator, 0, (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3), (sizeof(TByte4) + sizeof(TByte8) + sizeof(TByte32) + headerSize * 3));
+	}
+
+	{
+		bento::SafeSystemAllocator safeMemoryAllocator;
+		assert_memory_usage(safeMemoryAllocator, 0, 0, 0);
+		uint32_t headerSize = safeMemoryAllocator.header_size();
+
+		bento::Vector<TByte4> vc4(safeMemoryAllocator);
+		bento::Vector<TByte8> vc8(safeMemoryAllocator);
+		bento::Vector<TByte16> vc16(safeMemoryAllocator);
+
+		vc4.resize(4);
+		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) * 4 + headerSize), (sizeof(TByte4) * 4 + headerSize), 0);
+		vc8.resize(4);
+		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) * 4 + sizeof(TByte8) * 4 + headerSize * 2), (sizeof(TByte4) * 4 + sizeof(TByte8) * 4 + headerSize * 2), 0);
+		vc16.resize(4);
+		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) * 4 + sizeof(TByte8) * 4 + sizeof(TByte16) * 4 + headerSize * 3), (sizeof(TByte4) * 4 + sizeof(TByte8) * 4 + sizeof(TByte16) * 4 + headerSize * 3), 0);
+
+		vc4.free();
+		vc4.resize(8);
+		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) * 8 + sizeof(TByte8) * 4 + sizeof(TByte16) * 4 + headerSize * 3), (sizeof(TByte4) * 12 + sizeof(TByte8) * 4 + sizeof(TByte16) * 4 + headerSize * 4), (sizeof(TByte4) * 4 + headerSize));
+		vc8.free();
+		vc8.resize(8);
+		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) * 8 + sizeof(TByte8) * 8 + sizeof(TByte16) * 4 + headerSize * 3), (sizeof(TByte4) * 12 + sizeof(TByte8) * 12 + sizeof(TByte16) * 4 + headerSize * 5), (sizeof(TByte4) * 4 + sizeof(TByte8) * 4 + headerSize * 2 ));
+		vc16.free();
+		vc16.resize(8);
+		assert_memory_usage(safeMemoryAllocator, (sizeof(TByte4) * 8 + sizeof(TByte8) * 8 + sizeof(TByte16) * 8 + headerSize * 3), (sizeof(TByte4) * 12 + sizeof(TByte8) * 12 + sizeof(TByte16) * 12 + headerSize * 6), (sizeof(TByte4) * 4 + sizeof(TByte8) * 4 + sizeof(TByte16) * 4 + headerSize * 3));
+	}
+
+	{
+		bento::SafeSystemAllocator safeMemoryAllocator;
+		bento::DynamicString* string = bento::make_new<bento::DynamicString>(safeMemoryAllocator, safeMemoryAllocator);
+		string->resize(1000);
+		bento::make_delete<bento::DynamicString>(safeMemoryAllocator, string);
+	}
+}
+
+int main()
+{
+	bento::default_logger()->log(bento::LogLevel::info, "TESTS", "Running allocators tests.");
+
+	// Run the page allocator tests
+	test_page_allocator();
+
+	// Run the page allocator tests on pages bigger than 64 chunks
+	test_large_page_allocator(512);
+	test_large_page_allocator(4096);
+
+	// Run the concurrent page allocator tests
+	test_concurrent_page_allocator();
+
+	// Run the object pool tests
+	test_object_pool();
+
+	// Run the book allocator tests
+	test_book_allocator();
+
+	// Run the static book tests
+	test_static_book();
+
+	// Run the growable book allocator tests
+	test_growable_book_allocator();
+
+#if defined(LINUXPC)
+	// Run the mmap page source tests
+	test_mmap_page_source();
+#endif
+
+	// Run the compacting pool tests
+	test_compacting_pool();
+
+	// Run the thread cache allocator tests
+	test_thread_cache_allocator();
+
+	// Run the concurrent book allocator tests
+	test_concurrent_book_allocator();
+
+	// Run the book allocator tests
+	test_safe_system_allocator();
+
+	// Run the multithreaded safe system allocator tests
+	test_concurrent_safe_system_allocator();
+
+	// Run the batch allocation tests
+	test_batch_allocations();
+
+	// Run the sized deallocation tests
+	test_sized_deallocation();
+
+	// Run the aligned allocation tests
+	test_aligned_allocations();
+
+	// Run the arena allocator tests
+	test_arena_allocator();
+
+	// Run the frame allocator tests
+	test_frame_allocator();
+
+	// Run the tlsf allocator tests
+	test_tlsf_allocator();
+
+	// Run the virtual memory allocator tests
+	test_virtual_memory_allocator();
+
+	// Run the heap profiler tests
+	test_heap_profiler();
+
+	// Run the allocation trace tests
+	test_trace_allocator();
+
+	// Run the allocator statistics tests
+	test_allocator_stats();
+
+	// Run the standard allocator adapter tests
+	test_std_allocator();
+
+	// Run the allocator trimming tests
+	test_allocator_trimming();
 
 	bento::default_logger()->log(bento::LogLevel::info, "TESTS", "Allocators tests succeeded.");
 
@@ -0,0 +1,86 @@
+#pragma once
+
+// External includes
+#include <stdint.h>
+#include <stdio.h>
+#if defined(WINDOWSPC)
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+// Small deterministic generator so that every allocator replays the exact same workload
+struct RandomGenerator
+{
+	uint64_t state;
+
+	uint32_t next()
+	{
+		state = state * 6364136223846793005ull + 1442695040888963407ull;
+		return (uint32_t)(state >> 33);
+	}
+};
+
+#if defined(LINUXPC)
+// Reads a memory counter of /proc/self/status in bytes
+inline uint64_t read_status_memory(const char* format)
+{
+	uint64_t memory = 0;
+	FILE* status = fopen("/proc/self/status", "r");
+	if (status != nullptr)
+	{
+		char line[256];
+		while (fgets(line, sizeof(line), status) != nullptr)
+		{
+			unsigned long long kiloBytes = 0;
+			if (sscanf(line, format, &kiloBytes) == 1)
+			{
+				memory = kiloBytes * 1024;
+				break;
+			}
+		}
+		fclose(status);
+	}
+	return memory;
+}
+#endif
+
+// Returns the current resident set size of the process in bytes
+inline uint64_t current_resident_memory()
+{
+#if defined(WINDOWSPC)
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.WorkingSetSize;
+#elif defined(LINUXPC)
+	return read_status_memory("VmRSS: %llu kB");
+#else
+	return 0;
+#endif
+}
+
+// Resets the peak resident set size of the process if the platform allows it, the peak working set can't be reset on Windows
+inline void reset_peak_resident_memory()
+{
+#if defined(LINUXPC)
+	FILE* clearRefs = fopen("/proc/self/clear_refs", "w");
+	if (clearRefs != nullptr)
+	{
+		fputs("5", clearRefs);
+		fclose(clearRefs);
+	}
+#endif
+}
+
+// Returns the peak resident set size of the process in bytes since the last reset
+inline uint64_t peak_resident_memory()
+{
+#if defined(WINDOWSPC)
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.PeakWorkingSetSize;
+#elif defined(LINUXPC)
+	return read_status_memory("VmHWM: %llu kB");
+#else
+	return 0;
+#endif
+}
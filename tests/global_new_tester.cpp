@@ -0,0 +1,184 @@
+// SDK includes
+#include <bento_base/log.h>
+#include <bento_base/security.h>
+#include <bento_memory/global_new.h>
+
+// External includes
+#include <new>
+#include <string>
+#include <vector>
+
+// Allocated during the static initialization, before the routing allocators are guaranteed to exist
+std::vector<uint32_t>* EarlyValues = new std::vector<uint32_t>(100, 42);
+
+// The tested pointers are stored here so that the compiler can't elide the new/delete pairs
+void* volatile EscapedPointer = nullptr;
+
+// Fills the whole line, an implicitly padded over-aligned type is a level 4 warning on msvc
+struct alignas(64) TCacheLine64
+{
+	uint64_t counter;
+	uint8_t padding[56];
+};
+
+void test_early_allocations()
+{
+	// Memory handed out by the bootstrap path is still valid and freed through the right allocator
+	assert(EarlyValues->size() == 100);
+	assert((*EarlyValues)[99] == 42);
+
+	bento::global_new::Statistics before;
+	bento::global_new::statistics(before);
+	delete EarlyValues;
+	EarlyValues = nullptr;
+
+	bento::global_new::Statistics after;
+	bento::global_new::statistics(after);
+	assert(after.bootstrap_frees + after.small_frees + after.large_frees > before.bootstrap_frees + before.small_frees + before.large_frees);
+}
+
+void test_size_routing()
+{
+	size_t smallSizeLimit = bento::global_new::small_size_limit();
+	assert(smallSizeLimit > 0);
+
+	// Small objects go to the thread cached book allocator
+	{
+		bento::global_new::Statistics before;
+		bento::global_new::statistics(before);
+		uint64_t* value = new uint64_t(5);
+		EscapedPointer = value;
+		bento::global_new::Statistics after;
+		bento::global_new::statistics(after);
+		assert(after.small_allocations == before.small_allocations + 1);
+		assert(after.large_allocations == before.large_allocations);
+
+		delete value;
+		bento::global_new::statistics(after);
+		assert(after.small_frees == before.small_frees + 1);
+	}
+
+	// Large blocks go to the page source
+	{
+		bento::global_new::Statistics before;
+		bento::global_new::statistics(before);
+		char* buffer = new char[smallSizeLimit * 4];
+		EscapedPointer = buffer;
+		bento::global_new::Statistics after;
+		bento::global_new::statistics(after);
+		assert(after.large_allocations == before.large_allocations + 1);
+		assert(after.small_allocations == before.small_allocations);
+
+		delete[] buffer;
+		bento::global_new::statistics(after);
+		assert(after.large_frees == before.large_frees + 1);
+	}
+
+	// The runtime and the standard library are routed as well
+	{
+		bento::global_new::Statistics before;
+		bento::global_new::statistics(before);
+		std::string* string = new std::string("a string too long for the small string optimization");
+		EscapedPointer = string;
+		bento::global_new::Statistics after;
+		bento::global_new::statistics(after);
+		assert(after.small_allocations >= before.small_allocations + 2);
+		delete string;
+	}
+}
+
+// Checks how much the routed counters moved since the snapshot
+void assert_routed(const bento::global_new::Statistics& before, uint64_t smallAllocations, uint64_t smallFrees, uint64_t largeAllocations, uint64_t largeFrees)
+{
+	bento::global_new::Statistics after;
+	bento::global_new::statistics(after);
+	assert(after.small_allocations == before.small_allocations + smallAllocations);
+	assert(after.small_frees == before.small_frees + smallFrees);
+	assert(after.large_allocations == before.large_allocations + largeAllocations);
+	assert(after.large_frees == before.large_frees + largeFrees);
+}
+
+void test_aligned_and_sized_variants()
+{
+	const size_t smallSize = 16;
+	const size_t largeSize = bento::global_new::small_size_limit() * 4;
+	bento::global_new::Statistics before;
+
+	// Explicit calls to every replaced variant, the default runtime versions wouldn't move the counters
+	bento::global_new::statistics(before);
+	void* block = ::operator new(smallSize);
+	::operator delete(block);
+	assert_routed(before, 1, 1, 0, 0);
+
+	bento::global_new::statistics(before);
+	block = ::operator new[](largeSize);
+	::operator delete[](block);
+	assert_routed(before, 0, 0, 1, 1);
+
+	bento::global_new::statistics(before);
+	block = ::operator new(smallSize, std::nothrow);
+	assert(block != nullptr);
+	::operator delete(block, std::nothrow);
+	block = ::operator new[](smallSize, std::nothrow);
+	assert(block != nullptr);
+	::operator delete[](block, std::nothrow);
+	assert_routed(before, 2, 2, 0, 0);
+
+	bento::global_new::statistics(before);
+	block = ::operator new(smallSize);
+	::operator delete(block, smallSize);
+	block = ::operator new[](largeSize);
+	::operator delete[](block, largeSize);
+	assert_routed(before, 1, 1, 1, 1);
+
+	// Over-aligned types go through the aligned variants
+	bento::global_new::statistics(before);
+	TCacheLine64* counters[16];
+	for (uint32_t counterIdx = 0; counterIdx < 16; ++counterIdx)
+	{
+		counters[counterIdx] = new TCacheLine64();
+		EscapedPointer = counters[counterIdx];
+		assert(((uintptr_t)counters[counterIdx] & 63) == 0);
+	}
+	for (uint32_t counterIdx = 0; counterIdx < 16; ++counterIdx)
+		delete counters[counterIdx];
+	assert_routed(before, 16, 16, 0, 0);
+
+	bento::global_new::statistics(before);
+	block = ::operator new(largeSize, std::align_val_t(128));
+	assert(((uintptr_t)block & 127) == 0);
+	::operator delete(block, std::align_val_t(128));
+	block = ::operator new(largeSize, std::align_val_t(128), std::nothrow);
+	assert(((uintptr_t)block & 127) == 0);
+	::operator delete(block, std::align_val_t(128), std::nothrow);
+	assert_routed(before, 0, 0, 2, 2);
+
+	// Sized and aligned at once
+	bento::global_new::statistics(before);
+	block = ::operator new(smallSize, std::align_val_t(64));
+	assert(((uintptr_t)block & 63) == 0);
+	::operator delete(block, smallSize, std::align_val_t(64));
+	block = ::operator new[](largeSize, std::align_val_t(128));
+	assert(((uintptr_t)block & 127) == 0);
+	::operator delete[](block, largeSize, std::align_val_t(128));
+	assert_routed(before, 1, 1, 1, 1);
+}
+
+int main()
+{
+	bento::default_logger()->log(bento::LogLevel::info, "TESTS", "Running global new tests.");
+
+	// Run the static initialization tests
+	test_early_allocations();
+
+	// Run the size routing tests
+	test_size_routing();
+
+	// Run the aligned and sized variants tests
+	test_aligned_and_sized_variants();
+
+	bento::default_logger()->log(bento::LogLevel::info, "TESTS", "Global new tests succeeded.");
+
+	// If we got here, everything is fine
+	return 0;
+}
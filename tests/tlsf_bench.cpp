@@ -0,0 +1,111 @@
+// SDK includes
+#include <bento_base/log.h>
+#include <bento_base/security.h>
+#include <bento_memory/common.h>
+#include <bento_memory/system_allocator.h>
+#include <bento_memory/tlsf_allocator.h>
+#include <bento_collection/vector.h>
+
+// External includes
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+
+// Internal includes
+#include "bench_utils.h"
+
+// Number of allocations that are kept alive during the benchmark
+const uint32_t LiveSetSize = 4096;
+
+// Number of allocate/free pairs that are measured
+const uint32_t NumOperations = 1000000;
+
+// Mostly small sizes with a tail of bigger ones, which is what fragments a heap
+size_t random_size(RandomGenerator& generator)
+{
+	uint32_t bucket = generator.next() % 100;
+	if (bucket < 70)
+		return 8 + generator.next() % 120;
+	else if (bucket < 95)
+		return 128 + generator.next() % 1920;
+	return 2048 + generator.next() % 30720;
+}
+
+void log_percentiles(const char* allocatorName, const char* operation, bento::Vector<uint64_t>& latencies)
+{
+	std::sort(latencies.begin(), latencies.end());
+	uint32_t numSamples = latencies.size();
+	char line[256];
+	snprintf(line, sizeof(line), "%s %s p50=%lluns p99=%lluns p999=%lluns max=%lluns", allocatorName, operation
+		, (unsigned long long)latencies[numSamples / 2]
+		, (unsigned long long)latencies[(uint32_t)(numSamples * 0.99)]
+		, (unsigned long long)latencies[(uint32_t)(numSamples * 0.999)]
+		, (unsigned long long)latencies[numSamples - 1]);
+	bento::default_logger()->log(bento::LogLevel::info, "BENCH", line);
+}
+
+void run_latency_benchmark(const char* allocatorName, bento::IAllocator& allocator, bento::IAllocator& benchAllocator)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	RandomGenerator generator = { 0x853c49e6748fea9bull };
+
+	// Fill the live set so that the allocator is measured in a fragmented state
+	bento::Vector<void*> liveSet(benchAllocator, LiveSetSize);
+	for (uint32_t slotIdx = 0; slotIdx < LiveSetSize; ++slotIdx)
+	{
+		liveSet[slotIdx] = allocator.allocate(random_size(generator), 16);
+		assert(liveSet[slotIdx] != nullptr);
+	}
+
+	// Replace random slots of the live set, timing every free and every allocation
+	bento::Vector<uint64_t> allocateLatencies(benchAllocator, NumOperations);
+	bento::Vector<uint64_t> freeLatencies(benchAllocator, NumOperations);
+	for (uint32_t operationIdx = 0; operationIdx < NumOperations; ++operationIdx)
+	{
+		uint32_t slotIdx = generator.next() % LiveSetSize;
+		size_t size = random_size(generator);
+
+		Clock::time_point freeStart = Clock::now();
+		allocator.deallocate(liveSet[slotIdx]);
+		Clock::time_point allocateStart = Clock::now();
+		liveSet[slotIdx] = allocator.allocate(size, 16);
+		Clock::time_point allocateEnd = Clock::now();
+		assert(liveSet[slotIdx] != nullptr);
+
+		freeLatencies[operationIdx] = std::chrono::duration_cast<std::chrono::nanoseconds>(allocateStart - freeStart).count();
+		allocateLatencies[operationIdx] = std::chrono::duration_cast<std::chrono::nanoseconds>(allocateEnd - allocateStart).count();
+	}
+
+	// Release the live set
+	for (uint32_t slotIdx = 0; slotIdx < LiveSetSize; ++slotIdx)
+		allocator.deallocate(liveSet[slotIdx]);
+
+	log_percentiles(allocatorName, "allocate", allocateLatencies);
+	log_percentiles(allocatorName, "free", freeLatencies);
+}
+
+int main()
+{
+	bento::default_logger()->log(bento::LogLevel::info, "BENCH", "Running tlsf latency benchmark.");
+
+	// Holds the live set and the latency samples
+	bento::SystemAllocator benchAllocator;
+
+	// Reference: the C runtime heap
+	{
+		bento::SystemAllocator systemAllocator;
+		run_latency_benchmark("system", systemAllocator, benchAllocator);
+	}
+
+	// The whole live set fits in a 256MB region even in the worst case
+	{
+		bento::TlsfAllocator tlsfAllocator;
+		tlsfAllocator.initialize(benchAllocator, 256 * 1024 * 1024);
+		run_latency_benchmark("tlsf", tlsfAllocator, benchAllocator);
+		tlsfAllocator.release();
+	}
+
+	bento::default_logger()->log(bento::LogLevel::info, "BENCH", "Tlsf latency benchmark done.");
+
+	return 0;
+}